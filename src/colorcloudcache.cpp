@@ -0,0 +1,215 @@
+#include "colorcloudcache.h"
+#include "colorspace/batchconverter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char MAGIC[8]="VASCOCC";
+
+ColorCloudCache::ColorCloudCache(string directory){
+    setDirectory(directory);
+}
+
+void ColorCloudCache::setDirectory(string directory){
+    this->directory=directory;
+    if(!this->directory.empty() && this->directory[this->directory.size()-1]!='/'){
+        this->directory+='/';
+    }
+}
+
+uint64_t ColorCloudCache::hashFile(string path){
+    MappedFile content;
+    if(!content.open(path)){
+        return 0;
+    }
+    uint64_t hash=14695981039346656037ULL;
+    const unsigned char* data=content.data();
+    for(size_t i=0;i<content.size();i++){
+        hash^=data[i];
+        hash*=1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t ColorCloudCache::conversionFingerprint(){
+    static const uint64_t fingerprint=[](){
+        //16 levels by channel, extremes included
+        vector<uint32_t> keys;
+        for(uint32_t r=0;r<256;r+=17){
+            for(uint32_t g=0;g<256;g+=17){
+                for(uint32_t b=0;b<256;b+=17){
+                    keys.push_back((r<<16) | (g<<8) | b);
+                }
+            }
+        }
+        size_t n=keys.size();
+        vector<float> planes(3*n);
+        uint64_t hash=14695981039346656037ULL;
+        auto add=[&hash](const void* bytes, size_t size){
+            const unsigned char* data=static_cast<const unsigned char*>(bytes);
+            for(size_t i=0;i<size;i++){
+                hash^=data[i];
+                hash*=1099511628211ULL;
+            }
+        };
+        for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+            cs::ColorspaceInterface* space=cs::createColorspace(s);
+            double low[3];
+            double high[3];
+            space->getChannelRanges(low,high);
+            add(low,sizeof(low));
+            add(high,sizeof(high));
+            cs::convertPacked(*space,keys.data(),n,&planes[0],&planes[n],&planes[2*n],false);
+            add(planes.data(),planes.size()*sizeof(float));
+            delete space;
+        }
+        return hash;
+    }();
+    return fingerprint;
+}
+
+string ColorCloudCache::getPath(uint64_t hash) const{
+    char name[32];
+    snprintf(name,sizeof(name),"%016llx.vcc",(unsigned long long)hash);
+    return directory+name;
+}
+
+const ColorCloudCache::Header* ColorCloudCache::header() const{
+    return reinterpret_cast<const Header*>(file.data());
+}
+
+bool ColorCloudCache::open(uint64_t hash){
+    close();
+    if(!file.open(getPath(hash))){
+        return false;
+    }
+    //reject truncated, foreign or outdated files
+    bool valid=file.size()>=sizeof(Header);
+    if(valid){
+        const Header* h=header();
+        valid=memcmp(h->magic,MAGIC,sizeof(MAGIC))==0 && h->version==VERSION && h->hash==hash
+                && h->conversions==conversionFingerprint();
+        //header + names + colorCount*(key, count, 3 floats by space), without
+        //overflow whatever the counts read
+        size_t rest=file.size()-sizeof(Header);
+        valid=valid && h->spaceCount<=rest/NAME_SIZE;
+        if(valid){
+            rest-=h->spaceCount*NAME_SIZE;
+            size_t colorSize=4*(2+3*size_t(h->spaceCount));
+            valid=rest%colorSize==0 && h->colorCount==rest/colorSize;
+        }
+    }
+    if(!valid){
+        close();
+    }
+    return valid;
+}
+
+void ColorCloudCache::close(){
+    file.close();
+}
+
+bool ColorCloudCache::isOpen() const{
+    return file.isOpen();
+}
+
+bool ColorCloudCache::copyColors(cs::ColorCloud& cloud) const{
+    if(!isOpen()){
+        return false;
+    }
+    const Header* h=header();
+    size_t n=h->colorCount;
+    const unsigned char* keys=file.data()+sizeof(Header)+h->spaceCount*NAME_SIZE;
+    cloud.reserve(n);
+    cloud.resize(n);
+    memcpy(cloud.keys(),keys,n*4);
+    memcpy(cloud.counts(),keys+n*4,n*4);
+    return true;
+}
+
+bool ColorCloudCache::copyCoordinates(const cs::ColorspaceInterface& space, cs::ColorCloud& cloud) const{
+    return copyCoordinates(space,cloud.c1(),cloud.c2(),cloud.c3(),cloud.size());
+}
+
+bool ColorCloudCache::copyCoordinates(const cs::ColorspaceInterface& space, float* c1, float* c2, float* c3,
+                                      size_t count) const{
+    if(!isOpen()){
+        return false;
+    }
+    const Header* h=header();
+    size_t n=h->colorCount;
+    if(count!=n){
+        return false;
+    }
+    const char* names=reinterpret_cast<const char*>(file.data()+sizeof(Header));
+    for(uint32_t s=0;s<h->spaceCount;s++){
+        if(strncmp(names+s*NAME_SIZE,space.getName().c_str(),NAME_SIZE)!=0){
+            continue;
+        }
+        const float* planes=reinterpret_cast<const float*>(names+h->spaceCount*NAME_SIZE+n*8+s*n*12);
+        double scale[3];
+        double offset[3];
+        space.getNormalization(scale,offset);
+        float* dst[3]={c1,c2,c3};
+        for(int c=0;c<3;c++){
+            const float* src=planes+c*n;
+            const float sc=float(scale[c]);
+            const float of=float(offset[c]);
+            for(size_t i=0;i<n;i++){
+                dst[c][i]=src[i]*sc+of;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ColorCloudCache::save(uint64_t hash, const cs::ColorCloud& cloud, const unsigned short* highDepthColors){
+    string path=getPath(hash);
+    //write in a temporary file, renamed once complete : a crash never leaves a partial cache file
+    string tmpPath=path+".tmp";
+    ofstream out(tmpPath.c_str(),ios::binary);
+    if(!out){
+        return false;
+    }
+    size_t n=cloud.size();
+
+    Header h;
+    memcpy(h.magic,MAGIC,sizeof(MAGIC));
+    h.version=VERSION;
+    h.spaceCount=cs::COLORSPACE_COUNT;
+    h.hash=hash;
+    h.colorCount=n;
+    h.conversions=conversionFingerprint();
+    out.write(reinterpret_cast<const char*>(&h),sizeof(h));
+
+    vector<cs::ColorspaceInterface*> spaces;
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        spaces.push_back(cs::createColorspace(s));
+        char name[NAME_SIZE];
+        memset(name,0,NAME_SIZE);
+        strncpy(name,spaces.back()->getName().c_str(),NAME_SIZE-1);
+        out.write(name,NAME_SIZE);
+    }
+
+    out.write(reinterpret_cast<const char*>(cloud.keys()),n*4);
+    out.write(reinterpret_cast<const char*>(cloud.counts()),n*4);
+
+    vector<float> planes(3*n);
+    for(size_t s=0;s<spaces.size();s++){
+        if(highDepthColors!=NULL){
+            cs::convertBufferToPlanes(*spaces[s],highDepthColors,n,&planes[0],&planes[n],&planes[2*n],false);
+        }else{
+            cs::convertPacked(*spaces[s],cloud.keys(),n,&planes[0],&planes[n],&planes[2*n],false);
+        }
+        out.write(reinterpret_cast<const char*>(planes.data()),planes.size()*sizeof(float));
+        delete spaces[s];
+    }
+    out.close();
+    if(!out){
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return rename(tmpPath.c_str(),path.c_str())==0;
+}
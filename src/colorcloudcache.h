@@ -0,0 +1,131 @@
+#pragma once
+
+#include "mappedfile.h"
+#include "colorspace/colorcloud.h"
+#include <cstdint>
+
+/**
+ * @brief The ColorCloudCache class binary cache of the colors extracted from images
+ *
+ * One file by image, named after a hash of the image content, so a renamed or
+ * moved image is still found and a modified one is not. File layout (native
+ * endianness, every field 4 bytes aligned) :
+ *
+ *  + header : magic "VASCOCC", version, number of color spaces, content hash,
+ *    number of colors, fingerprint of the conversions
+ *  + color space names, 16 bytes each
+ *  + keys (0xRRGGBB) then counts, one uint32 per color
+ *  + for each color space : c1, c2 and c3 planes, one float per color
+ *
+ * Coordinates are stored raw (not normalized), so the cache stays valid if
+ * normalization ranges change. Files written by other conversion formulas (see
+ * conversionFingerprint) are rejected. Files are memory-mapped when opened.
+ */
+class ColorCloudCache{
+public:
+    /**
+     * @brief ColorCloudCache
+     * @param directory where cache files are written
+     */
+    ColorCloudCache(string directory="");
+    /**
+     * @brief setDirectory change where cache files are written
+     * @param directory
+     */
+    void setDirectory(string directory);
+    /**
+     * @brief hashFile hash the content of a file (64 bits FNV-1a)
+     * @param path
+     * @return 0 if the file can't be read
+     */
+    static uint64_t hashFile(string path);
+    /**
+     * @brief open map the cache file of an image
+     * @param hash content hash of the image
+     * @return false if there is no valid cache file for this image
+     */
+    bool open(uint64_t hash);
+    /**
+     * @brief close unmap the cache file
+     */
+    void close();
+    /**
+     * @brief isOpen
+     * @return true if a cache file is mapped
+     */
+    bool isOpen() const;
+    /**
+     * @brief copyColors fill keys and counts of a cloud from the opened cache file
+     * @param cloud
+     * @return false if no cache file is opened
+     */
+    bool copyColors(cs::ColorCloud& cloud) const;
+    /**
+     * @brief copyCoordinates fill normalized coordinates of a cloud from the opened cache file
+     * @param space color space whose coordinates are wanted
+     * @param cloud
+     * @return false if the cache file has no coordinates for this color space
+     */
+    bool copyCoordinates(const cs::ColorspaceInterface& space, cs::ColorCloud& cloud) const;
+    /**
+     * @brief copyCoordinates fill normalized coordinates planes from the opened cache file
+     * @param space color space whose coordinates are wanted
+     * @param c1 first channel plane, count elements
+     * @param c2 second channel plane, count elements
+     * @param c3 third channel plane, count elements
+     * @param count number of colors of the cached image
+     * @return false if the cache file has no coordinates for this color space
+     */
+    bool copyCoordinates(const cs::ColorspaceInterface& space, float* c1, float* c2, float* c3, size_t count) const;
+    /**
+     * @brief save write the cache file of an image
+     *
+     * Coordinates are computed for every available color space
+     *
+     * @param hash content hash of the image
+     * @param cloud colors of the image
+     * @param highDepthColors interleaved 16 bits colors used for conversion, NULL
+     * for 8 bits images (keys are converted)
+     * @return false if the file can't be written
+     */
+    bool save(uint64_t hash, const cs::ColorCloud& cloud, const unsigned short* highDepthColors=NULL);
+private:
+    /**
+     * @brief The Header struct beginning of a cache file
+     */
+    struct Header{
+        char magic[8];/*!< "VASCOCC"*/
+        uint32_t version;/*!< file format version*/
+        uint32_t spaceCount;/*!< number of color spaces*/
+        uint64_t hash;/*!< content hash of the image*/
+        uint64_t colorCount;/*!< number of colors*/
+        uint64_t conversions;/*!< fingerprint of the conversions which wrote the file*/
+    };
+    static const uint32_t VERSION=2;/*!< current file format version*/
+    static const size_t NAME_SIZE=16;/*!< size of a color space name*/
+
+    /**
+     * @brief getPath
+     * @param hash content hash of the image
+     * @return path of the cache file of an image
+     */
+    string getPath(uint64_t hash) const;
+    /**
+     * @brief conversionFingerprint hash of the default ranges of the color spaces
+     * and of the raw coordinates of a lattice of rgb colors in each of them
+     *
+     * Changes with any conversion formula, clamp or default range, so caches
+     * written by an other version of the conversions are not read.
+     *
+     * @return fingerprint, computed once
+     */
+    static uint64_t conversionFingerprint();
+    /**
+     * @brief header
+     * @return header of the mapped file
+     */
+    const Header* header() const;
+
+    string directory;/*!< where cache files are written*/
+    MappedFile file;/*!< opened cache file*/
+};
@@ -0,0 +1,154 @@
+#include "colorcloudrenderer.h"
+
+#define STRINGIFY(A) #A
+
+static const char* vertexShader="#version 120\n" POINT_FILTER_GLSL STRINGIFY(
+    attribute float c1;
+    attribute float c2;
+    attribute float c3;
+    //coordinates at the start of the morph
+    attribute float fromC1;
+    attribute float fromC2;
+    attribute float fromC3;
+    //packed key 0xRRGGBB read as 4 normalized bytes : blue, green, red, 0
+    attribute vec4 key;
+    uniform float morph;
+    varying vec4 color;
+    void main(){
+        vec3 pos=mix(vec3(fromC1,fromC2,fromC3),vec3(c1,c2,c3),morph);
+        color=vec4(key.z,key.y,key.x,1.);
+        //filtered points are moved out of the clip volume
+        gl_Position= accepted(pos) ? gl_ModelViewProjectionMatrix*vec4(pos,1.) : vec4(2.,2.,2.,1.);
+    }
+);
+
+static const char* fragmentShader="#version 120\n" STRINGIFY(
+    varying vec4 color;
+    void main(){
+        gl_FragColor=color;
+    }
+);
+
+ColorCloudRenderer::ColorCloudRenderer(){
+    ready=false;
+    count=0;
+    fromCount=0;
+}
+
+ColorCloudRenderer::~ColorCloudRenderer(){
+    if(ready){
+        glDeleteBuffers(PLANE_COUNT,buffers);
+    }
+}
+
+void ColorCloudRenderer::setup(){
+    glGenBuffers(PLANE_COUNT,buffers);
+    shader.setupShaderFromSource(GL_VERTEX_SHADER,vertexShader);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER,fragmentShader);
+    shader.bindAttribute(C1_PLANE,"c1");
+    shader.bindAttribute(C2_PLANE,"c2");
+    shader.bindAttribute(C3_PLANE,"c3");
+    shader.bindAttribute(KEY_PLANE,"key");
+    shader.bindAttribute(FROM_C1_PLANE,"fromC1");
+    shader.bindAttribute(FROM_C2_PLANE,"fromC2");
+    shader.bindAttribute(FROM_C3_PLANE,"fromC3");
+    shader.linkProgram();
+    ready=true;
+}
+
+void ColorCloudRenderer::upload(const cs::ColorCloud& cloud, const uint32_t* colors){
+    upload(colors!=NULL ? colors : cloud.keys(),cloud.c1(),cloud.c2(),cloud.c3(),cloud.size());
+}
+
+void ColorCloudRenderer::uploadCoordinates(const cs::ColorCloud& cloud){
+    uploadCoordinates(cloud.c1(),cloud.c2(),cloud.c3(),cloud.size());
+}
+
+void ColorCloudRenderer::upload(const uint32_t* colors, const float* c1, const float* c2, const float* c3, size_t n){
+    if(!ready){
+        setup();
+    }
+    //new points : no morph from the previous ones
+    fromCount=0;
+    glBindBuffer(GL_ARRAY_BUFFER,buffers[KEY_PLANE]);
+    glBufferData(GL_ARRAY_BUFFER,n*sizeof(uint32_t),colors,GL_STATIC_DRAW);
+    uploadCoordinates(c1,c2,c3,n);
+}
+
+void ColorCloudRenderer::uploadCoordinates(const float* c1, const float* c2, const float* c3, size_t n){
+    if(!ready){
+        setup();
+    }
+    const float* planes[3]={c1,c2,c3};
+    for(int i=0;i<3;i++){
+        glBindBuffer(GL_ARRAY_BUFFER,buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER,n*sizeof(float),planes[i],GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    count=n;
+}
+
+void ColorCloudRenderer::startMorph(const float* c1, const float* c2, const float* c3, float morph){
+    if(!ready){
+        return;
+    }
+    const float* planes[3]={c1,c2,c3};
+    size_t n=count;
+    bool morphing= morph<1 && fromCount==n && fromCoordinates.size()==3*n;
+    fromCoordinates.resize(3*n);
+    float* from=fromCoordinates.data();
+    //same blend as the shader
+    cs::parallelForBlocks(0,n,size_t(1)<<16,[&](size_t first, size_t last){
+        for(int c=0;c<3;c++){
+            float* start=from+c*n;
+            const float* end=planes[c];
+            for(size_t i=first;i<last;i++){
+                start[i]= morphing ? start[i]+(end[i]-start[i])*morph : end[i];
+            }
+        }
+    });
+    for(int i=0;i<3;i++){
+        glBindBuffer(GL_ARRAY_BUFFER,buffers[FROM_C1_PLANE+i]);
+        glBufferData(GL_ARRAY_BUFFER,n*sizeof(float),from+i*n,GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    fromCount=n;
+}
+
+void ColorCloudRenderer::setFilter(const PointFilter& filter){
+    this->filter=filter;
+}
+
+void ColorCloudRenderer::clear(){
+    count=0;
+}
+
+void ColorCloudRenderer::draw(float morph){
+    if(!ready || count==0){
+        return;
+    }
+    //without a start for these points, the morph is over
+    bool morphing= morph<1 && fromCount==count;
+    shader.begin();
+    shader.setUniform1f("morph",morphing ? morph : 1.f);
+    filter.setUniforms(shader);
+    for(int i=0;i<3;i++){
+        glBindBuffer(GL_ARRAY_BUFFER,buffers[i]);
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i,1,GL_FLOAT,GL_FALSE,0,0);
+        glBindBuffer(GL_ARRAY_BUFFER,buffers[morphing ? FROM_C1_PLANE+i : C1_PLANE+i]);
+        glEnableVertexAttribArray(FROM_C1_PLANE+i);
+        glVertexAttribPointer(FROM_C1_PLANE+i,1,GL_FLOAT,GL_FALSE,0,0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,buffers[KEY_PLANE]);
+    glEnableVertexAttribArray(KEY_PLANE);
+    glVertexAttribPointer(KEY_PLANE,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+
+    glDrawArrays(GL_POINTS,0,count);
+
+    for(int i=0;i<PLANE_COUNT;i++){
+        glDisableVertexAttribArray(i);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    shader.end();
+}
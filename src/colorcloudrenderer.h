@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ofMain.h"
+#include "colorspace/colorcloud.h"
+#include "colorspace/parallel.h"
+#include "pointfilter.h"
+
+/**
+ * @brief The ColorCloudRenderer class draw a ColorCloud as colored points
+ *
+ * Planes of the cloud are uploaded as they are, one vertex buffer by plane,
+ * without building an interleaved copy : a shader rebuilds the position from
+ * the c1, c2 and c3 planes and the color from the packed key.
+ *
+ * A morph keeps two sets of coordinates on the GPU and the shader interpolates
+ * between them, so an animation costs a uniform by frame whatever the number
+ * of points.
+ */
+class ColorCloudRenderer{
+public:
+    ColorCloudRenderer();
+    ~ColorCloudRenderer();
+    /**
+     * @brief upload upload colors and coordinates of a cloud
+     * @param cloud
+     * @param colors packed (0xRRGGBB) display color of each point, NULL to display
+     * the colors of the cloud
+     */
+    void upload(const cs::ColorCloud& cloud, const uint32_t* colors=NULL);
+    /**
+     * @brief uploadCoordinates upload only coordinates, colors are unchanged
+     * (color space has been changed)
+     * @param cloud
+     */
+    void uploadCoordinates(const cs::ColorCloud& cloud);
+    /**
+     * @brief upload upload colors and coordinates given as planes
+     * @param colors packed (0xRRGGBB) display color of each point
+     * @param c1 normalized first coordinate of each point
+     * @param c2 normalized second coordinate of each point
+     * @param c3 normalized third coordinate of each point
+     * @param n number of points
+     */
+    void upload(const uint32_t* colors, const float* c1, const float* c2, const float* c3, size_t n);
+    /**
+     * @brief uploadCoordinates upload only coordinates given as planes, colors are unchanged
+     * @param c1 normalized first coordinate of each point
+     * @param c2 normalized second coordinate of each point
+     * @param c3 normalized third coordinate of each point
+     * @param n number of points
+     */
+    void uploadCoordinates(const float* c1, const float* c2, const float* c3, size_t n);
+    /**
+     * @brief startMorph keep the points as drawn at a position of the current
+     * morph as the start of a new morph, the next uploadCoordinates gives its end
+     *
+     * Retargeting a running morph starts from the blend on screen, so points
+     * don't jump.
+     *
+     * @param c1 normalized first coordinate of each point, as last uploaded
+     * @param c2 normalized second coordinate of each point, as last uploaded
+     * @param c3 normalized third coordinate of each point, as last uploaded
+     * @param morph position in the current morph (see draw), 1 if there is none
+     */
+    void startMorph(const float* c1, const float* c2, const float* c3, float morph);
+    /**
+     * @brief draw draw points at their normalized coordinates, inside a camera
+     * (the model matrix places the normalized color space)
+     * @param morph position between the start (0) and the end (1) of the morph,
+     * see startMorph
+     */
+    void draw(float morph=1);
+    /**
+     * @brief clear draw nothing until next upload
+     */
+    void clear();
+    /**
+     * @brief setFilter hide the points rejected by a filter, from the next draw
+     * @param filter
+     */
+    void setFilter(const PointFilter& filter);
+private:
+    /**
+     * @brief setup create buffers and shader, needs a GL context
+     */
+    void setup();
+    enum Plane{C1_PLANE,C2_PLANE,C3_PLANE,KEY_PLANE,FROM_C1_PLANE,FROM_C2_PLANE,FROM_C3_PLANE,PLANE_COUNT};
+    bool ready;/*!< true once buffers and shader are created*/
+    GLuint buffers[PLANE_COUNT];/*!< one vertex buffer by plane*/
+    size_t count;/*!< number of uploaded points*/
+    size_t fromCount;/*!< number of points of the morph start, see startMorph*/
+    vector<float> fromCoordinates;/*!< c1, c2 then c3 plane of the morph start*/
+    ofShader shader;/*!< position and color from planes*/
+    PointFilter filter;/*!< hidden points*/
+};
@@ -32,41 +32,47 @@ public:
      */
     AC1C2(unsigned int red=255,unsigned int green=255,unsigned int blue=255){
         name="AC1C2";
-        c1Min=0.;
-        c2Min=255*(-sqrt(3)/2.);
-        c3Min=-255.;
-        c1Max=255.;
-        c2Max=255*(sqrt(3)/2.);
-        c3Max=255.;
+        setRanges(0.,255.,
+                  255*(-sqrt(3)/2.),255*(sqrt(3)/2.),
+                  -255.,255.);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief convertFromRGB cnvert from rgb to AC1C2 space
-    * @param[in] r red in [0;255]
-    * @param[in] g green in [0;255]
-    * @param[in] b blue in [0;255]
+    * @brief compute convert from rgb to AC1C2 color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 A component
+    * @param[out] o2 C1 component
+    * @param[out] o3 C2 component
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
+    template<typename Real>
+    static void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3){
+        o1=(red+green+blue)/Real(3);
+        o2=(sqrt(Real(3))/Real(2))*(red-green);
+        o3=blue-(red+green)*Real(0.5);
 
-        //convert from rgb to xyz color space
-        c1=(red+green+blue)/3.;
-        c2=(sqrt(3.)/2.)*(double(red)-double(green));
-        c3=blue-double(red+green)*0.5;
-
-        c2=round(c2*1000.)/1000.;
+        o2=round(o2*Real(1000))/Real(1000);
 
     }
 
-
-
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to AC1C2 color space
+    * @param[in] r red in [0;255]
+    * @param[in] g green in [0;255]
+    * @param[in] b blue in [0;255]
+    */
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
+    }
 
 
 };
@@ -0,0 +1,153 @@
+#ifndef CHANNELRANGES_H
+#define CHANNELRANGES_H
+#include "channelstats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief computeExactRanges lowest and highest value of each channel over the
+ * 2^24 8 bits rgb colors
+ *
+ * Each color space documents hand-entered ranges, a few of them too narrow
+ * (Lab and Luv clamp their chromaticities to them). The cube is swept without
+ * any clamp, in double precision, in parallel for known color spaces (see
+ * KnownColorspace). Costs about a second of conversion by core : cache the result.
+ * The ranges of space are left unchanged.
+ *
+ * @param[in,out] space color space to sweep
+ * @param[out] low lowest value of each channel
+ * @param[out] high highest value of each channel
+ */
+inline void computeExactRanges(ColorspaceInterface& space, double low[3], double high[3]){
+    //no clamp during the sweep
+    double savedLow[3];
+    double savedHigh[3];
+    space.getChannelRanges(savedLow,savedHigh);
+    const double unbounded[3]={1e30,1e30,1e30};
+    const double negativeUnbounded[3]={-1e30,-1e30,-1e30};
+    space.setChannelRanges(negativeUnbounded,unbounded);
+
+    //lowest and highest values of a block of colors
+    struct Ranges{
+        double low[3];
+        double high[3];
+    };
+    Ranges empty;
+    for(int c=0;c<3;c++){
+        empty.low[c]=HUGE_VAL;
+        empty.high[c]=-HUGE_VAL;
+    }
+    const size_t count=size_t(1)<<24;
+    const size_t blockSize=2048;
+    bool parallel=visitColorspace(space,KnownColorspace());
+    Ranges ranges=parallelReduce(0,count,parallel ? size_t(1)<<16 : count,empty,[&](size_t first, size_t last)->Ranges{
+        uint32_t keys[blockSize];
+        double planes[3][blockSize];
+        Ranges block=empty;
+        for(size_t start=first;start<last;start+=blockSize){
+            size_t n=min(blockSize,last-start);
+            for(size_t i=0;i<n;i++){
+                keys[i]=uint32_t(start+i);
+            }
+            convertPacked(space,keys,n,planes[0],planes[1],planes[2],false);
+            for(int c=0;c<3;c++){
+                //NaN (undefined hue or chromaticity of black) fails both tests
+                for(size_t i=0;i<n;i++){
+                    double v=planes[c][i];
+                    block.low[c]= v<block.low[c] ? v : block.low[c];
+                    block.high[c]= v>block.high[c] ? v : block.high[c];
+                }
+            }
+        }
+        return block;
+    },[](Ranges merged, const Ranges& block)->Ranges{
+        for(int c=0;c<3;c++){
+            merged.low[c]=min(merged.low[c],block.low[c]);
+            merged.high[c]=max(merged.high[c],block.high[c]);
+        }
+        return merged;
+    });
+    for(int c=0;c<3;c++){
+        low[c]=ranges.low[c];
+        high[c]=ranges.high[c];
+    }
+    space.setChannelRanges(savedLow,savedHigh);
+}
+
+/**
+ * @brief fitRanges ranges of the colors of statistics, in the units of the
+ * color space
+ *
+ * A channel narrower than 1/100 of its current range (a gray image has no
+ * chromaticity) is widened around its center to that width, a channel without
+ * values keeps its current range : fitted ranges can always be given to
+ * setChannelRanges.
+ *
+ * @param[in] space color space whose normalization gave the statistics
+ * @param[in] stats statistics of normalized colors (see ChannelStats)
+ * @param[out] low lowest value of each channel
+ * @param[out] high highest value of each channel
+ */
+inline void fitRanges(const ColorspaceInterface& space, const ChannelStats& stats, double low[3], double high[3]){
+    double currentLow[3];
+    double currentHigh[3];
+    space.getChannelRanges(currentLow,currentHigh);
+    for(int c=0;c<3;c++){
+        double width=currentHigh[c]-currentLow[c];
+        if(!(stats.minimum[c]<=stats.maximum[c])){
+            low[c]=currentLow[c];
+            high[c]=currentHigh[c];
+            continue;
+        }
+        //normalized value = value/width - currentLow/width
+        low[c]=currentLow[c]+double(stats.minimum[c])*width;
+        high[c]=currentLow[c]+double(stats.maximum[c])*width;
+        double minimumWidth=width/100.;
+        if(high[c]-low[c]<minimumWidth){
+            double center=0.5*(low[c]+high[c]);
+            low[c]=center-0.5*minimumWidth;
+            high[c]=center+0.5*minimumWidth;
+        }
+    }
+}
+
+/**
+ * @brief renormalize change the normalization of converted colors, in parallel,
+ * without converting them again
+ * @param[in,out] c1 first channel of each color
+ * @param[in,out] c2 second channel of each color
+ * @param[in,out] c3 third channel of each color
+ * @param[in] count number of colors
+ * @param[in] fromScale scale of each channel of the current normalization (see getNormalization)
+ * @param[in] fromOffset offset of each channel of the current normalization
+ * @param[in] toScale scale of each channel of the new normalization
+ * @param[in] toOffset offset of each channel of the new normalization
+ */
+template<typename Real>
+void renormalize(Real* c1, Real* c2, Real* c3, size_t count,
+                 const double fromScale[3], const double fromOffset[3],
+                 const double toScale[3], const double toOffset[3]){
+    Real* planes[3]={c1,c2,c3};
+    //value = (n-fromOffset)/fromScale, so n' = n*a+b
+    Real a[3];
+    Real b[3];
+    for(int c=0;c<3;c++){
+        a[c]=Real(toScale[c]/fromScale[c]);
+        b[c]=Real(toOffset[c]-fromOffset[c]*toScale[c]/fromScale[c]);
+    }
+    parallelForBlocks(0,count,size_t(1)<<16,[&](size_t first, size_t last){
+        for(int c=0;c<3;c++){
+            Real* plane=planes[c];
+            for(size_t i=first;i<last;i++){
+                plane[i]=plane[i]*a[c]+b[c];
+            }
+        }
+    });
+}
+
+}
+#endif // CHANNELRANGES_H
@@ -0,0 +1,269 @@
+#ifndef CHANNELSTATS_H
+#define CHANNELSTATS_H
+#include "multiconverter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The ChannelStats struct weighted histogram, mean, variance and range of
+ * each channel of normalized colors
+ *
+ * Colors are weighted by their number of pixels : statistics of the pixels of
+ * an image are computed from its distinct colors only.
+ */
+struct ChannelStats{
+    static const size_t BINS=256;/*!< histogram bins over [0;1], values out of it go to the border bins*/
+
+    double histogram[3][BINS];/*!< weight of each bin*/
+    double weight[3];/*!< total weight of each channel*/
+    double sum[3];/*!< weighted sum of each channel*/
+    double sumSquares[3];/*!< weighted sum of the squares of each channel*/
+    float minimum[3];/*!< lowest value of each channel*/
+    float maximum[3];/*!< highest value of each channel*/
+
+    ChannelStats(){
+        clear();
+    }
+
+    void clear(){
+        fill(&histogram[0][0],&histogram[0][0]+3*BINS,0.);
+        for(int c=0;c<3;c++){
+            weight[c]=0;
+            sum[c]=0;
+            sumSquares[c]=0;
+            minimum[c]=HUGE_VALF;
+            maximum[c]=-HUGE_VALF;
+        }
+    }
+
+    /**
+     * @brief add accumulate colors, NaN values are left out of their channel
+     * @param[in] c1 first channel of each color
+     * @param[in] c2 second channel of each color
+     * @param[in] c3 third channel of each color
+     * @param[in] weights weight of each color
+     * @param[in] count number of colors
+     */
+    template<typename Real>
+    void add(const Real* c1, const Real* c2, const Real* c3, const uint32_t* weights, size_t count){
+        const Real* planes[3]={c1,c2,c3};
+        //a channel after the other : one plane and one histogram in cache at a time
+        for(int c=0;c<3;c++){
+            const Real* plane=planes[c];
+            double* bins=histogram[c];
+            double w=0;
+            double s=0;
+            double s2=0;
+            float low=minimum[c];
+            float high=maximum[c];
+            for(size_t i=0;i<count;i++){
+                float v=float(plane[i]);
+                if(v!=v){
+                    continue;
+                }
+                double wi=weights[i];
+                w+=wi;
+                s+=wi*v;
+                s2+=wi*double(v)*v;
+                low=min(low,v);
+                high=max(high,v);
+                int bin=int(v*float(BINS));
+                bins[min(max(bin,0),int(BINS)-1)]+=wi;
+            }
+            weight[c]+=w;
+            sum[c]+=s;
+            sumSquares[c]+=s2;
+            minimum[c]=low;
+            maximum[c]=high;
+        }
+    }
+
+    /**
+     * @brief merge add the colors of other statistics
+     * @param[in] other
+     */
+    void merge(const ChannelStats& other){
+        for(int c=0;c<3;c++){
+            weight[c]+=other.weight[c];
+            sum[c]+=other.sum[c];
+            sumSquares[c]+=other.sumSquares[c];
+            minimum[c]=min(minimum[c],other.minimum[c]);
+            maximum[c]=max(maximum[c],other.maximum[c]);
+            for(size_t b=0;b<BINS;b++){
+                histogram[c][b]+=other.histogram[c][b];
+            }
+        }
+    }
+
+    double mean(int channel) const{
+        return weight[channel]>0 ? sum[channel]/weight[channel] : 0.;
+    }
+
+    double variance(int channel) const{
+        if(weight[channel]<=0){
+            return 0.;
+        }
+        double m=mean(channel);
+        return max(0.,sumSquares[channel]/weight[channel]-m*m);
+    }
+
+    /**
+     * @brief percentile
+     * @param[in] channel
+     * @param[in] p in [0;1]
+     * @return value below which a part p of the weight lies, interpolated in its
+     * bin (precise to 1/BINS)
+     */
+    double percentile(int channel, double p) const{
+        double target=p*weight[channel];
+        double cumulated=0;
+        for(size_t b=0;b<BINS;b++){
+            double h=histogram[channel][b];
+            if(h>0 && cumulated+h>=target){
+                return (double(b)+(target-cumulated)/h)/BINS;
+            }
+            cumulated+=h;
+        }
+        return 1.;
+    }
+
+    /**
+     * @brief maxBin
+     * @param[in] channel
+     * @return weight of the highest bin of the channel
+     */
+    double maxBin(int channel) const{
+        return *max_element(histogram[channel],histogram[channel]+BINS);
+    }
+};
+
+/**
+ * @brief forEachStatsChunk accumulate statistics on chunks of colors, in
+ * parallel, then merge them in the order of the chunks
+ *
+ * Chunks have a fixed size, so the sums don't depend on the number of threads
+ * nor on which one ends first : statistics are the same from one run to the next.
+ *
+ * @param[in] count number of colors
+ * @param[in] chunkSize number of colors by chunk, count for a single chunk
+ * run by the calling thread
+ * @param[out] stats statistics of all the colors
+ * @param[in] f called as f(first,last,chunkStats) to add the colors of a chunk
+ */
+template<typename F>
+void forEachStatsChunk(size_t count, size_t chunkSize, ChannelStats& stats, const F& f){
+    stats.clear();
+    if(count==0){
+        return;
+    }
+    chunkSize=max<size_t>(chunkSize,1);
+    vector<ChannelStats> chunks((count+chunkSize-1)/chunkSize);
+    parallelFor(0,chunks.size(),[&](size_t chunk){
+        size_t first=chunk*chunkSize;
+        f(first,min(count,first+chunkSize),chunks[chunk]);
+    });
+    for(size_t chunk=0;chunk<chunks.size();chunk++){
+        stats.merge(chunks[chunk]);
+    }
+}
+
+/**
+ * @brief forEachBlockWithStats run convert on blocks of colors, then add the
+ * block to the statistics while it is still in cache
+ *
+ * Chunks of blocks are spread on all the cores for known color spaces (see
+ * KnownColorspace), each chunk has its own statistics (see forEachStatsChunk).
+ *
+ * @param[in,out] space color space used for conversion
+ * @param[in] weights weight of each color
+ * @param[in] count number of colors
+ * @param[out] c1 first channel values, count elements
+ * @param[out] c2 second channel values, count elements
+ * @param[out] c3 third channel values, count elements
+ * @param[out] stats statistics of the converted colors
+ * @param[in] convert called as convert(space,first,n,c1,c2,c3) with the planes starting at first
+ */
+template<typename Real, typename F>
+void forEachBlockWithStats(ColorspaceInterface& space, const uint32_t* weights, size_t count,
+                           Real* c1, Real* c2, Real* c3, ChannelStats& stats, const F& convert){
+    bool parallel=visitColorspace(space,KnownColorspace());
+    //a block of 8 bits keys and its output fit in L2
+    const size_t blockSize=2048;
+    forEachStatsChunk(count,parallel ? size_t(1)<<16 : count,stats,[&](size_t first, size_t last, ChannelStats& chunkStats){
+        for(size_t start=first;start<last;start+=blockSize){
+            size_t n=min(blockSize,last-start);
+            convert(space,start,n,c1+start,c2+start,c3+start);
+            chunkStats.add(c1+start,c2+start,c3+start,weights+start,n);
+        }
+    });
+}
+
+/**
+ * @brief convertPackedWithStats convertPacked, computing the statistics of the
+ * normalized colors in the same pass
+ * @param[in,out] space color space used for conversion
+ * @param[in] keys packed colors
+ * @param[in] weights weight of each color
+ * @param[in] count number of colors
+ * @param[out] c1 first normalized channel values, count elements
+ * @param[out] c2 second normalized channel values, count elements
+ * @param[out] c3 third normalized channel values, count elements
+ * @param[out] stats statistics of the normalized colors
+ */
+template<typename Real>
+void convertPackedWithStats(ColorspaceInterface& space, const uint32_t* keys, const uint32_t* weights, size_t count,
+                            Real* c1, Real* c2, Real* c3, ChannelStats& stats){
+    forEachBlockWithStats(space,weights,count,c1,c2,c3,stats,
+                          [&](ColorspaceInterface& s, size_t first, size_t n, Real* b1, Real* b2, Real* b3){
+        convertPacked(s,keys+first,n,b1,b2,b3,true);
+    });
+}
+
+/**
+ * @brief convertBufferWithStats convertBufferToPlanes, computing the statistics
+ * of the normalized colors in the same pass
+ * @param[in,out] space color space used for conversion
+ * @param[in] rgb interleaved red, green and blue values (depth given by T)
+ * @param[in] weights weight of each color
+ * @param[in] count number of colors
+ * @param[out] c1 first normalized channel values, count elements
+ * @param[out] c2 second normalized channel values, count elements
+ * @param[out] c3 third normalized channel values, count elements
+ * @param[out] stats statistics of the normalized colors
+ */
+template<typename T, typename Real>
+void convertBufferWithStats(ColorspaceInterface& space, const T* rgb, const uint32_t* weights, size_t count,
+                            Real* c1, Real* c2, Real* c3, ChannelStats& stats){
+    validateBuffer(rgb,count);
+    forEachBlockWithStats(space,weights,count,c1,c2,c3,stats,
+                          [&](ColorspaceInterface& s, size_t first, size_t n, Real* b1, Real* b2, Real* b3){
+        InterleavedInput<T,Real> in={rgb+3*first};
+        PlanarOutput<Real> o={b1,b2,b3};
+        convert<Real>(s,in,o,n,true);
+    });
+}
+
+/**
+ * @brief computeChannelStats statistics of already converted colors, in parallel
+ * @param[in] c1 first channel of each color
+ * @param[in] c2 second channel of each color
+ * @param[in] c3 third channel of each color
+ * @param[in] weights weight of each color
+ * @param[in] count number of colors
+ * @param[out] stats
+ */
+template<typename Real>
+void computeChannelStats(const Real* c1, const Real* c2, const Real* c3, const uint32_t* weights, size_t count,
+                         ChannelStats& stats){
+    forEachStatsChunk(count,size_t(1)<<16,stats,[&](size_t first, size_t last, ChannelStats& chunkStats){
+        chunkStats.add(c1+first,c2+first,c3+first,weights+first,last-first);
+    });
+}
+
+}
+#endif // CHANNELSTATS_H
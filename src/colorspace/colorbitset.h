@@ -0,0 +1,188 @@
+#ifndef COLORBITSET_H
+#define COLORBITSET_H
+#include "colorcloud.h"
+#include "parallel.h"
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief popcount number of bits set in a 64 bits word
+ */
+inline unsigned int popcount(uint64_t word){
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_popcountll(word);
+#else
+    word=word-((word>>1) & 0x5555555555555555ULL);
+    word=(word & 0x3333333333333333ULL)+((word>>2) & 0x3333333333333333ULL);
+    word=(word+(word>>4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned int)((word*0x0101010101010101ULL)>>56);
+#endif
+}
+
+/**
+ * @brief The ColorBitset class set of 8 bits rgb colors, one bit by possible color
+ *
+ * 2^24 bits (2MB) by set. Set operations work on whole 64 bits words, in plain
+ * loops the compiler vectorizes.
+ */
+class ColorBitset{
+public:
+    static const size_t WORD_COUNT=(size_t(1)<<24)/64;/*!< number of 64 bits words*/
+
+    ColorBitset(): words(WORD_COUNT,0){
+    }
+
+    /**
+     * @brief insert add a packed color (0xRRGGBB)
+     */
+    void insert(uint32_t key){
+        words[key>>6]|=uint64_t(1)<<(key & 63);
+    }
+
+    /**
+     * @brief contains test if a packed color (0xRRGGBB) is in the set
+     */
+    bool contains(uint32_t key) const{
+        return (words[key>>6]>>(key & 63)) & 1;
+    }
+
+    /**
+     * @brief addPixels add the colors of a pixels buffer
+     *
+     * Channels after the third one (alpha) are ignored. With one or two channels
+     * the first one is used as a gray level.
+     *
+     * @param[in] data interleaved pixels values
+     * @param[in] pixelCount number of pixels in the buffer
+     * @param[in] channels number of channels per pixel
+     */
+    void addPixels(const unsigned char* data, size_t pixelCount, size_t channels){
+        for(size_t i=0;i<pixelCount;i++){
+            const unsigned char* p=data+i*channels;
+            if(channels>=3){
+                insert((uint32_t(p[0])<<16) | (uint32_t(p[1])<<8) | uint32_t(p[2]));
+            }else{
+                insert((uint32_t(p[0])<<16) | (uint32_t(p[0])<<8) | uint32_t(p[0]));
+            }
+        }
+    }
+
+    /**
+     * @brief clear remove all the colors
+     */
+    void clear(){
+        fill(words.begin(),words.end(),0);
+    }
+
+    /**
+     * @brief swap exchange the colors of two sets
+     */
+    void swap(ColorBitset& o){
+        words.swap(o.words);
+    }
+
+    /**
+     * @brief unite this = this | o
+     */
+    void unite(const ColorBitset& o){
+        uint64_t* w=words.data();
+        const uint64_t* ow=o.words.data();
+        for(size_t i=0;i<WORD_COUNT;i++){
+            w[i]|=ow[i];
+        }
+    }
+
+    /**
+     * @brief intersect this = this & o
+     */
+    void intersect(const ColorBitset& o){
+        uint64_t* w=words.data();
+        const uint64_t* ow=o.words.data();
+        for(size_t i=0;i<WORD_COUNT;i++){
+            w[i]&=ow[i];
+        }
+    }
+
+    /**
+     * @brief subtract this = this & ~o
+     */
+    void subtract(const ColorBitset& o){
+        uint64_t* w=words.data();
+        const uint64_t* ow=o.words.data();
+        for(size_t i=0;i<WORD_COUNT;i++){
+            w[i]&=~ow[i];
+        }
+    }
+
+    /**
+     * @brief size
+     * @return number of colors in the set
+     */
+    size_t size() const{
+        size_t n=0;
+        for(size_t i=0;i<WORD_COUNT;i++){
+            n+=popcount(words[i]);
+        }
+        return n;
+    }
+
+    /**
+     * @brief extractColors write the colors of the set in a cloud, sorted by key
+     *
+     * Done in parallel : each block of words counts its colors, then writes
+     * them at its offset. Counts of the cloud are set to 1.
+     *
+     * @param[out] cloud keys and counts are filled, coordinates are not computed
+     */
+    void extractColors(ColorCloud& cloud) const{
+        const size_t blockWords=4096;
+        const size_t blocks=WORD_COUNT/blockWords;
+        vector<size_t> offsets(blocks+1,0);
+        parallelFor(0,blocks,[&](size_t b){
+            size_t n=0;
+            for(size_t i=b*blockWords;i<(b+1)*blockWords;i++){
+                n+=popcount(words[i]);
+            }
+            offsets[b+1]=n;
+        });
+        for(size_t b=0;b<blocks;b++){
+            offsets[b+1]+=offsets[b];
+        }
+        cloud.reserve(offsets[blocks]);
+        cloud.resize(offsets[blocks]);
+        uint32_t* keys=cloud.keys();
+        uint32_t* counts=cloud.counts();
+        parallelFor(0,blocks,[&](size_t b){
+            size_t n=offsets[b];
+            for(size_t i=b*blockWords;i<(b+1)*blockWords;i++){
+                uint64_t word=words[i];
+                while(word!=0){
+                    unsigned int bit=popcount((word & (~word+1))-1);
+                    keys[n]=uint32_t(i*64+bit);
+                    counts[n]=1;
+                    n++;
+                    word&=word-1;
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief getWords
+     * @return the words of the set, bit k of word i is color i*64+k
+     */
+    const uint64_t* getWords() const{
+        return words.data();
+    }
+    uint64_t* getWords(){
+        return words.data();
+    }
+
+private:
+    vector<uint64_t> words;/*!< one bit by possible color*/
+};
+}
+#endif // COLORBITSET_H
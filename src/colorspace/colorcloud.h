@@ -0,0 +1,153 @@
+#ifndef COLORCLOUD_H
+#define COLORCLOUD_H
+#include "batchconverter.h"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace cs{
+/**
+ * @brief The ColorCloud class distinct colors of an image and their coordinates
+ * in a color space, stored as a structure of arrays
+ *
+ * Planes :
+ *  + keys : packed colors (0xRRGGBB)
+ *  + counts : number of pixels of each color
+ *  + c1, c2, c3 : normalized ([0;1]) coordinates in the current color space
+ *
+ * All the planes live in one block (the arena), allocated by reserve and kept
+ * between images while the capacity is large enough. Planes are 64 bytes
+ * aligned and contiguous, so they can be handed as is to GPU buffers, file
+ * writers or statistics without any copy.
+ */
+class ColorCloud{
+public:
+    ColorCloud(): arena(NULL), cap(0), count(0),
+        keyPlane(NULL), countPlane(NULL), c1Plane(NULL), c2Plane(NULL), c3Plane(NULL){
+    }
+
+    ~ColorCloud(){
+        free(arena);
+    }
+
+    /**
+     * @brief reserve make room for at least capacity colors
+     *
+     * Content is lost if the arena has to grow
+     *
+     * @param[in] capacity
+     */
+    void reserve(size_t capacity){
+        if(capacity<=cap){
+            return;
+        }
+        free(arena);
+        count=0;
+        size_t plane=planeBytes(capacity);
+        arena=static_cast<unsigned char*>(malloc(5*plane+alignment));
+        if(arena==NULL){
+            cap=0;
+            throw bad_alloc();
+        }
+        unsigned char* base=arena+(alignment-reinterpret_cast<uintptr_t>(arena)%alignment)%alignment;
+        keyPlane=reinterpret_cast<uint32_t*>(base);
+        countPlane=reinterpret_cast<uint32_t*>(base+plane);
+        c1Plane=reinterpret_cast<float*>(base+2*plane);
+        c2Plane=reinterpret_cast<float*>(base+3*plane);
+        c3Plane=reinterpret_cast<float*>(base+4*plane);
+        cap=capacity;
+    }
+
+    /**
+     * @brief resize set the number of colors, must not exceed capacity()
+     * @param[in] n
+     */
+    void resize(size_t n){
+        if(n>cap){
+            throw length_error("ColorCloud::resize greater than capacity");
+        }
+        count=n;
+    }
+
+    /**
+     * @brief clear remove all colors, the arena is kept
+     */
+    void clear(){
+        count=0;
+    }
+
+    /**
+     * @brief convert compute normalized coordinates of all the colors in a color space
+     * @param[in,out] space
+     */
+    void convert(ColorspaceInterface& space){
+        convertPacked(space,keyPlane,count,c1Plane,c2Plane,c3Plane,true);
+    }
+
+    size_t size() const{
+        return count;
+    }
+    size_t capacity() const{
+        return cap;
+    }
+    bool empty() const{
+        return count==0;
+    }
+
+    uint32_t* keys(){
+        return keyPlane;
+    }
+    const uint32_t* keys() const{
+        return keyPlane;
+    }
+    uint32_t* counts(){
+        return countPlane;
+    }
+    const uint32_t* counts() const{
+        return countPlane;
+    }
+    float* c1(){
+        return c1Plane;
+    }
+    const float* c1() const{
+        return c1Plane;
+    }
+    float* c2(){
+        return c2Plane;
+    }
+    const float* c2() const{
+        return c2Plane;
+    }
+    float* c3(){
+        return c3Plane;
+    }
+    const float* c3() const{
+        return c3Plane;
+    }
+
+private:
+    ColorCloud(const ColorCloud&);
+    ColorCloud& operator=(const ColorCloud&);
+
+    static const size_t alignment=64;/*!< planes alignment, a cache line*/
+
+    /**
+     * @brief planeBytes size of a plane, rounded up to keep next plane aligned
+     */
+    static size_t planeBytes(size_t capacity){
+        size_t bytes=capacity*4;
+        return (bytes+alignment-1)/alignment*alignment;
+    }
+
+    unsigned char* arena;/*!< memory block of all the planes*/
+    size_t cap;/*!< number of colors the arena can hold*/
+    size_t count;/*!< number of colors*/
+
+    uint32_t* keyPlane;/*!< packed colors (0xRRGGBB)*/
+    uint32_t* countPlane;/*!< number of pixels of each color*/
+    float* c1Plane;/*!< normalized first channel*/
+    float* c2Plane;/*!< normalized second channel*/
+    float* c3Plane;/*!< normalized third channel*/
+};
+}
+#endif // COLORCLOUD_H
@@ -0,0 +1,381 @@
+#ifndef COLORINDEX_H
+#define COLORINDEX_H
+#include "colorbitset.h"
+#include "tiledconverter.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The ColorIndex class distinct colors of an 8 bits image and the color of each pixel
+ *
+ * Each pixel gets the id of its color : the rank of the color among the
+ * distinct colors, sorted by key (0xRRGGBB), like the colors of a cloud
+ * extracted by DenseColorCounter. Anything computed once by distinct color
+ * (coordinates, selection...) is then scattered to the pixels with a single
+ * lookup.
+ *
+ * The pixels are read once, by the parallel dedup scan : each thread sets a
+ * bit by color in its own bitset (united at the end) and records the key of
+ * each pixel where its id goes. buildIds then turns the keys into ids in place,
+ * from the number of bits set before each color, and counts the pixels of each
+ * color.
+ */
+class ColorIndex{
+public:
+    ColorIndex(): pixelCount(0), colorCount(0){
+    }
+
+    /**
+     * @brief scan find the distinct colors of an image and record the color of each pixel
+     *
+     * Channels after the third one (alpha) are ignored. With one or two channels
+     * the first one is used as a gray level (see DenseColorCounter).
+     *
+     * @param[in] data interleaved pixels values, not used once scanned
+     * @param[in] pixelCount number of pixels
+     * @param[in] channels number of channels per pixel
+     * @return number of distinct colors
+     */
+    size_t scan(const unsigned char* data, size_t pixelCount, size_t channels=3){
+        this->pixelCount=pixelCount;
+        ids.resize(pixelCount);
+        counts.clear();
+
+        size_t chunks=max<size_t>(1,min<size_t>(threadCount(),pixelCount/chunkMinSize));
+        size_t chunkSize=(pixelCount+chunks-1)/chunks;
+        vector<ColorBitset> chunkColors(chunks);
+        uint32_t* keys=ids.data();
+        parallelFor(0,chunks,[&](size_t c){
+            size_t first=min(pixelCount,c*chunkSize);
+            size_t last=min(pixelCount,first+chunkSize);
+            markPixels(data+channels*first,last-first,channels,chunkColors[c],keys+first);
+        });
+        for(size_t c=1;c<chunks;c++){
+            chunkColors[0].unite(chunkColors[c]);
+        }
+        present.swap(chunkColors[0]);
+        colorCount=rankColors(present,ranks);
+        return colorCount;
+    }
+
+    /**
+     * @brief buildIds turn the keys recorded by scan into color ids, in parallel,
+     * and count the pixels of each color
+     */
+    void buildIds(){
+        vector<atomic<uint32_t> > pixelsByColor(colorCount);
+        uint32_t* keys=ids.data();
+        parallelForBlocks(0,pixelCount,blockSize,[&](size_t first, size_t last){
+            rankPixels(ranks.data(),keys+first,last-first,pixelsByColor.data());
+        });
+        counts.resize(colorCount);
+        for(size_t id=0;id<colorCount;id++){
+            counts[id]=pixelsByColor[id].load(memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief getColors
+     * @param[out] cloud distinct colors, cloud.keys()[id] is the color of id, counts
+     * are the number of pixels of each color after buildIds, 1 before
+     */
+    void getColors(ColorCloud& cloud) const{
+        present.extractColors(cloud);
+        if(counts.size()==cloud.size()){
+            copy(counts.begin(),counts.end(),cloud.counts());
+        }
+    }
+
+    size_t getPixelCount() const{
+        return pixelCount;
+    }
+    size_t getColorCount() const{
+        return colorCount;
+    }
+    /**
+     * @brief getUniqueRatio
+     * @return number of distinct colors by pixel, in ]0;1]
+     */
+    double getUniqueRatio() const{
+        return pixelCount==0 ? 1. : double(colorCount)/double(pixelCount);
+    }
+    /**
+     * @brief getIds
+     * @return color id of each pixel after buildIds, its key (0xRRGGBB) before
+     */
+    const vector<uint32_t>& getIds() const{
+        return ids;
+    }
+    /**
+     * @brief clear release the ids of the pixels and the colors
+     */
+    void clear(){
+        vector<uint32_t>().swap(ids);
+        vector<uint32_t>().swap(counts);
+        pixelCount=0;
+        colorCount=0;
+    }
+
+    /**
+     * @brief The RankedWord struct a word of the bitset and the id of its first color
+     */
+    struct RankedWord{
+        uint64_t bits;
+        uint64_t rank;
+    };
+
+    /**
+     * @brief markPixels body of the dedup scan : add the colors of pixels to a
+     * set and record their keys
+     * @param[in] data interleaved pixels values
+     * @param[in] count number of pixels
+     * @param[in] channels number of channels per pixel
+     * @param[in,out] colors set of colors
+     * @param[out] keys packed color (0xRRGGBB) of each pixel
+     */
+    static void markPixels(const unsigned char* data, size_t count, size_t channels,
+                           ColorBitset& colors, uint32_t* keys){
+        for(size_t i=0;i<count;i++){
+            const unsigned char* p=data+i*channels;
+            uint32_t key= channels>=3 ? (uint32_t(p[0])<<16) | (uint32_t(p[1])<<8) | uint32_t(p[2])
+                                      : (uint32_t(p[0])<<16) | (uint32_t(p[0])<<8) | uint32_t(p[0]);
+            colors.insert(key);
+            keys[i]=key;
+        }
+    }
+
+    /**
+     * @brief rankColors store each word of a set next to the rank of its first
+     * color : one cache line is read to find the id of a color
+     * @param[in] colors set of colors
+     * @param[out] ranks ranked words of the set
+     * @return number of colors of the set
+     */
+    static size_t rankColors(const ColorBitset& colors, vector<RankedWord>& ranks){
+        ranks.resize(ColorBitset::WORD_COUNT);
+        const uint64_t* words=colors.getWords();
+        uint64_t rank=0;
+        for(size_t w=0;w<ColorBitset::WORD_COUNT;w++){
+            ranks[w].bits=words[w];
+            ranks[w].rank=rank;
+            rank+=popcount(words[w]);
+        }
+        return size_t(rank);
+    }
+
+    /**
+     * @brief rankPixels body of buildIds : replace keys by the ids of their
+     * colors and count the pixels of each color
+     * @param[in] ranks ranked words of the colors (see rankColors)
+     * @param[in,out] keys packed color of each pixel, replaced by its id
+     * @param[in] count number of pixels
+     * @param[in,out] pixelsByColor number of pixels of each id, shared by threads
+     */
+    static void rankPixels(const RankedWord* ranks, uint32_t* keys, size_t count, atomic<uint32_t>* pixelsByColor){
+        uint32_t lastKey=0xffffffff;
+        uint32_t lastId=0;
+        uint32_t run=0;
+        for(size_t i=0;i<count;i++){
+            uint32_t key=keys[i];
+            //neighbour pixels often share the same color : skip the lookup, count the run at once
+            if(key!=lastKey){
+                if(run>0){
+                    pixelsByColor[lastId].fetch_add(run,memory_order_relaxed);
+                }
+                const RankedWord& w=ranks[key>>6];
+                uint64_t below=(uint64_t(1)<<(key & 63))-1;
+                lastId=uint32_t(w.rank)+popcount(w.bits & below);
+                lastKey=key;
+                run=0;
+            }
+            keys[i]=lastId;
+            run++;
+        }
+        if(run>0){
+            pixelsByColor[lastId].fetch_add(run,memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief scatterCoordinates give each pixel the coordinates of its color
+     * @param[in] ids color id of each pixel
+     * @param[in] count number of pixels
+     * @param[in] coordinates interleaved coordinates of each color id
+     * @param[out] c1 first coordinate of each pixel
+     * @param[out] c2 second coordinate of each pixel
+     * @param[out] c3 third coordinate of each pixel
+     */
+    static void scatterCoordinates(const uint32_t* ids, size_t count, const float* coordinates,
+                                   float* c1, float* c2, float* c3){
+        for(size_t i=0;i<count;i++){
+            const float* c=coordinates+3*size_t(ids[i]);
+            c1[i]=c[0];
+            c2[i]=c[1];
+            c3[i]=c[2];
+        }
+    }
+
+private:
+    static const size_t chunkMinSize=size_t(1)<<20;/*!< pixels by thread worth a 2MB bitset*/
+    static const size_t blockSize=size_t(1)<<16;/*!< pixels by block of buildIds*/
+
+    size_t pixelCount;/*!< number of pixels*/
+    size_t colorCount;/*!< number of distinct colors*/
+    ColorBitset present;/*!< colors of the image*/
+    vector<RankedWord> ranks;/*!< words of the bitset and their first id*/
+    vector<uint32_t> ids;/*!< key, then color id, of each pixel*/
+    vector<uint32_t> counts;/*!< number of pixels of each color id, empty before buildIds*/
+};
+
+/**
+ * @brief convertIndexed convert the distinct colors of an image, then scatter
+ * their coordinates to the pixels, tile by tile (see forEachTile)
+ * @param[in,out] space color space used for conversion
+ * @param[in] index distinct colors and ids of the pixels (buildIds done)
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ * @param[in] sink called as sink(firstPixel,count,c1,c2,c3), returns false to stop
+ * @param[in] tilePixels number of pixels by tile
+ * @return false if the sink stopped the conversion
+ */
+template<typename Sink>
+bool convertIndexed(ColorspaceInterface& space, const ColorIndex& index, bool normalized,
+                    Sink& sink, size_t tilePixels=size_t(1)<<18){
+    ColorCloud colors;
+    index.getColors(colors);
+    //interleaved : the three channels of a color are read in one cache line
+    vector<float> coordinates(3*colors.size());
+    //a single block for color spaces that can't be shared by threads
+    bool known=visitColorspace(space,KnownColorspace());
+    parallelForBlocks(0,colors.size(),known ? size_t(1)<<16 : colors.size(),[&](size_t first, size_t last){
+        PackedInput<float> in={colors.keys()+first};
+        InterleavedOutput<float> out={&coordinates[3*first]};
+        convert<float>(space,in,out,last-first,normalized);
+    });
+
+    const uint32_t* ids=index.getIds().data();
+    const float* u=coordinates.data();
+    auto fill=[&](size_t first, size_t count, float* c1, float* c2, float* c3){
+        ColorIndex::scatterCoordinates(ids+first,count,u,c1,c2,c3);
+    };
+    return forEachTile(index.getPixelCount(),tilePixels,true,fill,sink);
+}
+
+/**
+ * @brief remapSampleSize number of pixels on which the costs of the passes are measured
+ */
+static const size_t remapSampleSize=16384;
+
+/**
+ * @brief The RemapCosts struct time by pixel of each pass of a direct conversion
+ * and of a remap, measured on the same pixels by the same thread
+ */
+struct RemapCosts{
+    double convert;/*!< conversion of a pixel*/
+    double scan;/*!< marking the color of a pixel and recording its key (see ColorIndex::scan)*/
+    double remap;/*!< giving its id to a pixel and scattering the coordinates of its color to it*/
+};
+
+/**
+ * @brief measureRemapCosts time the passes of both conversions on the first pixels of an image
+ *
+ * Each pass is timed alone, serially, by running the loop the parallel passes
+ * run on each of their blocks : all the passes scale alike with the number of
+ * threads, so serial costs compare as parallel ones would. Allocations and
+ * per image work (uniting and ranking the bitsets) are not timed, they don't
+ * grow with the image.
+ *
+ * @param[in,out] space color space used for conversion
+ * @param[in] rgb interleaved red, green and blue values
+ * @param[in] count number of pixels to time, from the first one
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ * @return seconds by pixel of each pass
+ */
+inline RemapCosts measureRemapCosts(ColorspaceInterface& space, const unsigned char* rgb, size_t count,
+                                    bool normalized){
+    RemapCosts costs={0,0,0};
+    if(count==0){
+        return costs;
+    }
+    typedef chrono::steady_clock Clock;
+    vector<float> planes(3*count);
+    vector<uint32_t> keys(count);
+    ColorBitset colors;
+    vector<ColorIndex::RankedWord> ranks;
+    //pixels (maybe a mapped file) are read once before timing
+    ColorIndex::markPixels(rgb,count,3,colors,keys.data());
+    size_t colorCount=ColorIndex::rankColors(colors,ranks);
+    vector<atomic<uint32_t> > pixelsByColor(colorCount);
+    vector<float> coordinates(3*colorCount,0.f);
+
+    Clock::time_point start=Clock::now();
+    convertBufferToPlanes(space,rgb,count,&planes[0],&planes[count],&planes[2*count],normalized);
+    Clock::time_point converted=Clock::now();
+    ColorIndex::markPixels(rgb,count,3,colors,keys.data());
+    Clock::time_point scanned=Clock::now();
+    ColorIndex::rankPixels(ranks.data(),keys.data(),count,pixelsByColor.data());
+    ColorIndex::scatterCoordinates(keys.data(),count,coordinates.data(),&planes[0],&planes[count],&planes[2*count]);
+    Clock::time_point remapped=Clock::now();
+
+    costs.convert=chrono::duration<double>(converted-start).count()/double(count);
+    costs.scan=chrono::duration<double>(scanned-converted).count()/double(count);
+    costs.remap=chrono::duration<double>(remapped-scanned).count()/double(count);
+    return costs;
+}
+
+/**
+ * @brief convertPixels convert every pixel of an image, streamed tile by tile
+ *
+ * Generic depths are converted pixel by pixel (see convertTiled)
+ */
+template<typename T, typename Sink>
+bool convertPixels(ColorspaceInterface& space, const T* rgb, size_t pixelCount, bool normalized, Sink& sink){
+    return convertTiled(space,rgb,pixelCount,normalized,sink);
+}
+
+/**
+ * @brief convertPixels convert every pixel of an 8 bits image, streamed tile by tile
+ *
+ * If converting only the distinct colors and scattering them to the pixels
+ * through a ColorIndex is cheaper than converting each pixel, the remap is
+ * used. The choice is made from the costs by pixel of each pass (see
+ * measureRemapCosts) : the remap is skipped if scanning and remapping a pixel
+ * costs more than converting it, else the image is scanned and the measured
+ * ratio of distinct colors by pixel decides. Few distinct colors and expensive
+ * color spaces (Lab, Luv, HSI) favor the remap, cheap linear ones (XYZ) rarely do.
+ *
+ * @param[in,out] space color space used for conversion
+ * @param[in] rgb interleaved red, green and blue values
+ * @param[in] pixelCount number of pixels of the image
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ * @param[in] sink called as sink(firstPixel,count,c1,c2,c3), returns false to stop
+ * @return false if the sink stopped the conversion
+ */
+template<typename Sink>
+bool convertPixels(ColorspaceInterface& space, const unsigned char* rgb, size_t pixelCount, bool normalized, Sink& sink){
+    if(!visitColorspace(space,KnownColorspace())){
+        return convertTiled(space,rgb,pixelCount,normalized,sink);
+    }
+
+    //remap : every pixel is scanned and remapped, the distinct colors only are converted
+    RemapCosts costs=measureRemapCosts(space,rgb,min(pixelCount,remapSampleSize),normalized);
+    if(costs.scan+costs.remap>=costs.convert){
+        //slower whatever the number of distinct colors
+        return convertTiled(space,rgb,pixelCount,normalized,sink);
+    }
+    ColorIndex index;
+    index.scan(rgb,pixelCount);
+    //the scan is done, the rest of the remap against a direct conversion
+    if(costs.remap+index.getUniqueRatio()*costs.convert>=costs.convert){
+        return convertTiled(space,rgb,pixelCount,normalized,sink);
+    }
+    index.buildIds();
+    return convertIndexed(space,index,normalized,sink);
+}
+
+}
+#endif // COLORINDEX_H
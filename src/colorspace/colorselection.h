@@ -0,0 +1,85 @@
+#ifndef COLORSELECTION_H
+#define COLORSELECTION_H
+#include "parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief selectProjected select the points projected inside a rectangle of the screen
+ *
+ * Points behind the camera are never selected.
+ *
+ * @param[in] c1 first coordinate of each point
+ * @param[in] c2 second coordinate of each point
+ * @param[in] c3 third coordinate of each point
+ * @param[in] count number of points
+ * @param[in] matrix projection of the points, 16 values in ofMatrix4x4 layout :
+ * clip coordinates are the row vector (c1,c2,c3,1) times the matrix
+ * @param[in] low lowest corner of the rectangle (x, y), in normalized device coordinates
+ * @param[in] high highest corner of the rectangle (x, y), in normalized device coordinates
+ * @param[out] selected 1 for each point inside the rectangle, 0 for the others
+ */
+inline void selectProjected(const float* c1, const float* c2, const float* c3, size_t count,
+                            const float matrix[16], const float low[2], const float high[2], uint8_t* selected){
+    const float* m=matrix;
+    parallelForBlocks(0,count,size_t(1)<<16,[&](size_t first, size_t last){
+        for(size_t i=first;i<last;i++){
+            float x=c1[i]*m[0]+c2[i]*m[4]+c3[i]*m[8]+m[12];
+            float y=c1[i]*m[1]+c2[i]*m[5]+c3[i]*m[9]+m[13];
+            float w=c1[i]*m[3]+c2[i]*m[7]+c3[i]*m[11]+m[15];
+            //compared to the rectangle scaled by w : no division, NaN points fail every test
+            selected[i]=uint8_t(w>0 && x>=low[0]*w && x<=high[0]*w && y>=low[1]*w && y<=high[1]*w);
+        }
+    });
+}
+
+/**
+ * @brief remapIds give each pixel the value of its id, as a mask of the selected colors
+ *
+ * A branch-free gather, in parallel blocks : with AVX2 the compiler turns the
+ * loop into vector gathers.
+ *
+ * @param[in] ids id of each pixel
+ * @param[in] count number of pixels
+ * @param[in] table value of each id
+ * @param[out] out value of each pixel
+ */
+template<typename T>
+void remapIds(const uint32_t* ids, size_t count, const T* table, T* out){
+    parallelForBlocks(0,count,size_t(1)<<16,[&](size_t first, size_t last){
+        for(size_t i=first;i<last;i++){
+            out[i]=table[ids[i]];
+        }
+    });
+}
+
+/**
+ * @brief selectIdsInRect select the ids of the pixels of a rectangle of an image
+ * @param[in] ids id of each pixel, row by row
+ * @param[in] width number of pixels by row
+ * @param[in] x0 first column of the rectangle
+ * @param[in] y0 first row of the rectangle
+ * @param[in] x1 last column of the rectangle (excluded)
+ * @param[in] y1 last row of the rectangle (excluded)
+ * @param[out] selected set to 1 for each id found in the rectangle, other ids are unchanged
+ * @param[in] idCount number of ids, larger ids are ignored
+ */
+inline void selectIdsInRect(const uint32_t* ids, size_t width, size_t x0, size_t y0, size_t x1, size_t y1,
+                            uint8_t* selected, size_t idCount){
+    for(size_t y=y0;y<y1;y++){
+        const uint32_t* row=ids+y*width;
+        for(size_t x=x0;x<x1;x++){
+            if(row[x]<idCount){
+                selected[row[x]]=1;
+            }
+        }
+    }
+}
+
+}
+#endif // COLORSELECTION_H
@@ -2,6 +2,7 @@
 #define COLORSPACEINTERFACE
 #include <stdexcept>
 #include <string>
+#include <cmath>
 using namespace std;
 
 namespace cs{
@@ -21,13 +22,44 @@ class ColorspaceInterface{
 public:
 
 
+    virtual ~ColorspaceInterface(){}
+
     /**
      * @brief convertFromRGB cnvert from rgb to the given color space
      * @param[in] r red in [0;255]
      * @param[in] g green in [0;255]
      * @param[in] b blue in [0;255]
      */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue)=0;
+    void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
+        checkRGB(red,green,blue);
+        //store rgb color
+        r=red;
+        g=green;
+        b=blue;
+
+        computeFromRGB(red,green,blue);
+    }
+
+    /**
+     * @brief convertScaledRGB convert from rgb to the given color space without
+     * validating the input
+     *
+     * Used by batch conversion (see batchconverter.h) once the whole buffer has been
+     * validated, so inputs of any depth (8 bits, 16 bits, float) rescaled to [0;255]
+     * can be converted without the per pixel checks of convertFromRGB.
+     *
+     * @param[in] red red in [0;255]
+     * @param[in] green green in [0;255]
+     * @param[in] blue blue in [0;255]
+     */
+    void convertScaledRGB(double red, double green, double blue){
+        //store rounded rgb color
+        r=(unsigned int)(red+0.5);
+        g=(unsigned int)(green+0.5);
+        b=(unsigned int)(blue+0.5);
+
+        computeFromRGB(red,green,blue);
+    }
 
     /**
      * @brief getC1
@@ -70,10 +102,7 @@ public:
      * @return normalized ([0;1]) value for first channel
      */
     double getNormalizedC1() const{
-        if(c1Max - c1Min==0){
-            throw runtime_error("c1Max - c1Min==0");
-        }
-        return (c1 - c1Min)/(c1Max - c1Min);
+        return c1*c1Scale+c1Offset;
     }
 
     /**
@@ -81,10 +110,7 @@ public:
      * @return normalized ([0;1]) value for second channel
      */
     double getNormalizedC2() const{
-        if(c2Max - c2Min==0){
-            throw runtime_error("c2Max - c2Min==0");
-        }
-        return (c2 - c2Min)/(c2Max - c2Min);
+        return c2*c2Scale+c2Offset;
     }
 
 
@@ -93,10 +119,7 @@ public:
      * @return normalized ([0;1]) value for first channel
      */
     double getNormalizedC3() const{
-        if(c3Max - c3Min==0){
-            throw runtime_error("c3Max - c3Min==0");
-        }
-        return (c3 - c3Min)/(c3Max - c3Min);
+        return c3*c3Scale+c3Offset;
     }
     /**
      * @brief getNormalizedColor get normalized ([0;1]) color
@@ -111,6 +134,51 @@ public:
 
     }
 
+    /**
+     * @brief getNormalization get the affine transform used to normalize each channel
+     *
+     * normalized value = value*scale + offset
+     *
+     * @param[out] scale scale of first, second and third channel
+     * @param[out] offset offset of first, second and third channel
+     */
+    void getNormalization(double scale[3], double offset[3]) const{
+        scale[0]=c1Scale;
+        scale[1]=c2Scale;
+        scale[2]=c3Scale;
+        offset[0]=c1Offset;
+        offset[1]=c2Offset;
+        offset[2]=c3Offset;
+    }
+
+    /**
+     * @brief getChannelRanges get the range of each channel, used for normalization
+     * @param[out] low minimal value of first, second and third channel
+     * @param[out] high maximal value of first, second and third channel
+     */
+    void getChannelRanges(double low[3], double high[3]) const{
+        low[0]=c1Min;
+        low[1]=c2Min;
+        low[2]=c3Min;
+        high[0]=c1Max;
+        high[1]=c2Max;
+        high[2]=c3Max;
+    }
+
+    /**
+     * @brief setChannelRanges replace the range of each channel (see
+     * channelranges.h for exact and fitted ranges)
+     *
+     * Color spaces clamping a channel to its range (Lab, Luv) clamp to the new
+     * one. Takes effect from the next conversion.
+     *
+     * @param[in] low minimal value of first, second and third channel
+     * @param[in] high maximal value of first, second and third channel
+     */
+    void setChannelRanges(const double low[3], const double high[3]){
+        setRanges(low[0],high[0],low[1],high[1],low[2],high[2]);
+    }
+
     /**
      * @brief getRGB return color in RGB color space
      * @param[out] red
@@ -134,7 +202,55 @@ public:
         return name;
     }
 protected:
+    /**
+     * @brief computeFromRGB compute channels values of the color space
+     *
+     * Input is not validated, see convertFromRGB and convertScaledRGB
+     *
+     * @param[in] red red in [0;255]
+     * @param[in] green green in [0;255]
+     * @param[in] blue blue in [0;255]
+     */
+    virtual void computeFromRGB(double red, double green, double blue)=0;
+
     //helper functions
+    /**
+     * @brief setRanges set channels ranges and precompute normalization
+     *
+     * Ranges are validated here, once, so normalization never has to check them
+     *
+     * @param[in] min1 minimal possible value for c1
+     * @param[in] max1 maximal possible value for c1
+     * @param[in] min2 minimal possible value for c2
+     * @param[in] max2 maximal possible value for c2
+     * @param[in] min3 minimal possible value for c3
+     * @param[in] max3 maximal possible value for c3
+     */
+    void setRanges(double min1, double max1, double min2, double max2, double min3, double max3){
+        if(max1 - min1<=0){
+            throw runtime_error("c1Max - c1Min<=0");
+        }
+        if(max2 - min2<=0){
+            throw runtime_error("c2Max - c2Min<=0");
+        }
+        if(max3 - min3<=0){
+            throw runtime_error("c3Max - c3Min<=0");
+        }
+        c1Min=min1;
+        c1Max=max1;
+        c2Min=min2;
+        c2Max=max2;
+        c3Min=min3;
+        c3Max=max3;
+
+        c1Scale=1./(c1Max-c1Min);
+        c2Scale=1./(c2Max-c2Min);
+        c3Scale=1./(c3Max-c3Min);
+        c1Offset=-c1Min*c1Scale;
+        c2Offset=-c2Min*c2Scale;
+        c3Offset=-c3Min*c3Scale;
+    }
+
     /**
      * @brief checkRGB  test validty of red, green and blue value
      *
@@ -212,6 +328,13 @@ protected:
     double c3Min;/*!< minimal possible value for c3 */
     double c3Max;/*!< maximal possible value for c3 */
 
+    double c1Scale;/*!< 1/(c1Max-c1Min) */
+    double c1Offset;/*!< -c1Min/(c1Max-c1Min) */
+    double c2Scale;/*!< 1/(c2Max-c2Min) */
+    double c2Offset;/*!< -c2Min/(c2Max-c2Min) */
+    double c3Scale;/*!< 1/(c3Max-c3Min) */
+    double c3Offset;/*!< -c3Min/(c3Max-c3Min) */
+
     string name;/*!< color space name*/
 
 };
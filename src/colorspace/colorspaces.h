@@ -0,0 +1,51 @@
+#ifndef COLORSPACES_H
+#define COLORSPACES_H
+#include "xyz.h"
+#include "luv.h"
+#include "lab.h"
+#include "ac1c2.h"
+#include "yc1c2.h"
+#include "hsi.h"
+#include "i1i2i3.h"
+#include "h1h2h3.h"
+
+namespace cs{
+
+/**
+ * @brief COLORSPACE_COUNT number of available color spaces
+ */
+static const int COLORSPACE_COUNT=8;
+
+/**
+ * @brief createColorspace create one of the available color spaces
+ *
+ * Index order : XYZ, LUV, LAB, AC1C2, YC1C2, HSI, I1I2I3, H1H2H3
+ * (order of F1 to F8 keys)
+ *
+ * @param[in] index in [0;COLORSPACE_COUNT[
+ * @return new color space, to be deleted by the caller
+ */
+inline ColorspaceInterface* createColorspace(int index){
+    switch(index){
+    case 0:
+        return new XYZ();
+    case 1:
+        return new LUV();
+    case 2:
+        return new LAB();
+    case 3:
+        return new AC1C2();
+    case 4:
+        return new YC1C2();
+    case 5:
+        return new HSI();
+    case 6:
+        return new I1I2I3();
+    case 7:
+        return new H1H2H3();
+    }
+    throw runtime_error("unknown color space index");
+}
+
+}
+#endif // COLORSPACES_H
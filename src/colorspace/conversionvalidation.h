@@ -0,0 +1,300 @@
+#ifndef CONVERSIONVALIDATION_H
+#define CONVERSIONVALIDATION_H
+#include "colorspaces.h"
+#include "tiledconverter.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The ChannelError struct difference between a fast conversion and the
+ * reference one, for a channel
+ */
+struct ChannelError{
+    double maxError;/*!< largest absolute difference, in the units of the color space*/
+    double meanError;/*!< mean absolute difference, in the units of the color space*/
+    uint32_t worstColor;/*!< packed rgb (0xRRGGBB) 8 bits color of the largest difference, or the one the 16 bits color was made from*/
+    size_t nanMismatches;/*!< number of colors NaN for the compared conversion only*/
+    size_t undefinedValues;/*!< number of colors NaN for the reference only, given a value by the compared conversion*/
+};
+
+/**
+ * @brief The ConversionReport struct differences between a conversion of a
+ * sweep of rgb colors and the reference one
+ */
+struct ConversionReport{
+    ChannelError channels[3];/*!< difference of each channel*/
+    double maxNormalizedError;/*!< largest difference of the channels, as a part of their range*/
+};
+
+/**
+ * @brief referenceConversion convert a color with the scalar formulas of the
+ * color spaces, written apart from their compute functions, in double precision
+ *
+ * Batch conversion and convertFromRGB share the compute function of each color
+ * space : comparing them would only check the batch loops. These formulas are
+ * the original per color code of the color spaces, one color at a time, so
+ * they also check the compute functions.
+ *
+ * @param[in] spaceIndex see createColorspace
+ * @param[in] red in [0;255], not only integers for deeper inputs
+ * @param[in] green in [0;255]
+ * @param[in] blue in [0;255]
+ * @param[in] low lowest value of each channel, Luv and Lab clamp their chromaticities to it
+ * @param[in] high highest value of each channel
+ * @param[out] out value of each channel
+ */
+inline void referenceConversion(int spaceIndex, double red, double green, double blue,
+                                const double low[3], const double high[3], double out[3]){
+    double r=red;
+    double g=green;
+    double b=blue;
+    //xyz of rgb white (255,255,255), reference white of Luv and Lab
+    const double xb=255*0.607+255*0.174+255*0.200;
+    const double yb=255*0.299+255*0.587+255*0.114;
+    const double zb=255*0.066+255*1.116;
+    double x=red*0.607+green*0.174+blue*0.200;
+    double y=red*0.299+green*0.587+blue*0.114;
+    double z=green*0.066+blue*1.116;
+    double yr=y/yb;
+    double l= yr>0.008856 ? 116*pow(yr,1./3.)-16 : 903.3*yr;
+    switch(spaceIndex){
+    case 0:
+        out[0]=x;
+        out[1]=y;
+        out[2]=z;
+        return;
+    case 1:{
+        double ut=4*x/(x+15*y+3*z);
+        double utb=4*xb/(xb+15*yb+3*zb);
+        double vt=9*y/(x+15*y+3*z);
+        double vtb=9*yb/(xb+15*yb+3*zb);
+        out[0]=l;
+        out[1]=max(min(13*l*(ut-utb),high[1]),low[1]);
+        out[2]=max(min(13*l*(vt-vtb),high[2]),low[2]);
+        return;
+    }
+    case 2:{
+        double f[3]={x/xb,yr,z/zb};
+        for(int c=0;c<3;c++){
+            f[c]= f[c]>0.008856 ? pow(f[c],1./3.) : 7.787*f[c]+16./116.;
+        }
+        out[0]=l;
+        out[1]=max(min(500*(f[0]-f[1]),high[1]),low[1]);
+        out[2]=max(min(500*(f[1]-f[2]),high[2]),low[2]);
+        return;
+    }
+    case 3:
+        out[0]=(r+g+b)/3.;
+        out[1]=round((sqrt(3.)/2.)*(r-g)*1000.)/1000.;
+        out[2]=b-(r+g)*0.5;
+        return;
+    case 4:
+        out[0]=(r+g+b)/3.;
+        out[1]=round((r-(g+b)*0.5)*1000.)/1000.;
+        out[2]=(sqrt(3.)/2.)*(b-g);
+        return;
+    case 5:{
+        bool grayLevel= red==green && green==blue;
+        out[0]=M_PI;
+        out[1]=0;
+        if(!grayLevel){
+            double rg=r-g;
+            double rb=r-b;
+            double gb=g-b;
+            out[0]=acos(0.5*(rg+rb)/sqrt(pow(rg,2)+rb*gb));
+            if(blue>green){
+                out[0]=2*M_PI-out[0];
+            }
+            out[1]=1.-3.*min(r,min(g,b))/(r+g+b);
+        }
+        out[2]=(r+g+b)/3.;
+        return;
+    }
+    case 6:
+        out[0]=(r+g+b)/3.;
+        out[1]=0.5*(r-b);
+        out[2]=0.25*(2.*r-g-b);
+        return;
+    case 7:
+        out[0]=r+g;
+        out[1]=r-g;
+        out[2]=b-0.5*(r+g);
+        return;
+    }
+    throw runtime_error("unknown color space index");
+}
+
+/**
+ * @brief compareToReference compare a conversion to referenceConversion, the
+ * scalar double precision formulas of each color space, on a sweep of colors
+ *
+ * NaN (undefined hue or chromaticity of black) is only expected where the
+ * reference gives NaN.
+ *
+ * @param[in] spaceIndex see createColorspace
+ * @param[in] count number of swept colors, color i is made from the 8 bits color i%2^24
+ * @param[in] blockSize number of colors given to each call of convert
+ * @param[in] parallel if true, blocks are swept on all the cores, convert must
+ * be thread safe, otherwise by the calling thread only
+ * @param[in] convert called as convert(first,n,rgb,c1,c2,c3) to convert the
+ * colors first to first+n, in the units of the color space, and give their
+ * interleaved red, green and blue values in [0;255] to the reference
+ * @return differences, Real gives the precision of the conversion
+ */
+template<typename Real, typename F>
+ConversionReport compareToReference(int spaceIndex, size_t count, size_t blockSize, bool parallel, const F& convert){
+    //differences of a block of colors, meanError holds the sum of the differences
+    struct Differences{
+        ChannelError channels[3];
+        size_t compared[3];
+    };
+    Differences none;
+    for(int c=0;c<3;c++){
+        none.channels[c].maxError=0;
+        none.channels[c].meanError=0;
+        none.channels[c].worstColor=0;
+        none.channels[c].nanMismatches=0;
+        none.channels[c].undefinedValues=0;
+        none.compared[c]=0;
+    }
+    double low[3];
+    double high[3];
+    ColorspaceInterface* space=createColorspace(spaceIndex);
+    space->getChannelRanges(low,high);
+    Differences total=parallelReduce(0,count,parallel ? size_t(1)<<16 : count,none,[&](size_t first, size_t last)->Differences{
+        vector<double> rgb(3*blockSize);
+        vector<Real> planes(3*blockSize);
+        Differences block=none;
+        for(size_t start=first;start<last;start+=blockSize){
+            size_t n=min(blockSize,last-start);
+            convert(start,n,rgb.data(),&planes[0],&planes[blockSize],&planes[2*blockSize]);
+            for(size_t i=0;i<n;i++){
+                double expected[3];
+                referenceConversion(spaceIndex,rgb[3*i],rgb[3*i+1],rgb[3*i+2],low,high,expected);
+                for(int c=0;c<3;c++){
+                    ChannelError& channel=block.channels[c];
+                    double value=planes[c*blockSize+i];
+                    bool expectedNaN=expected[c]!=expected[c];
+                    if(expectedNaN && value==value){
+                        channel.undefinedValues++;
+                        continue;
+                    }
+                    if(expectedNaN || value!=value){
+                        channel.nanMismatches+= expectedNaN ? 0 : 1;
+                        continue;
+                    }
+                    double error=fabs(value-expected[c]);
+                    channel.meanError+=error;
+                    block.compared[c]++;
+                    if(error>channel.maxError){
+                        channel.maxError=error;
+                        channel.worstColor=uint32_t((start+i) & 0xffffff);
+                    }
+                }
+            }
+        }
+        return block;
+    },[](Differences merged, const Differences& block)->Differences{
+        for(int c=0;c<3;c++){
+            ChannelError& channel=merged.channels[c];
+            const ChannelError& blockChannel=block.channels[c];
+            //on equal errors, the first color swept is kept
+            if(blockChannel.maxError>channel.maxError){
+                channel.maxError=blockChannel.maxError;
+                channel.worstColor=blockChannel.worstColor;
+            }
+            channel.meanError+=blockChannel.meanError;
+            channel.nanMismatches+=blockChannel.nanMismatches;
+            channel.undefinedValues+=blockChannel.undefinedValues;
+            merged.compared[c]+=block.compared[c];
+        }
+        return merged;
+    });
+
+    double scale[3];
+    double offset[3];
+    space->getNormalization(scale,offset);
+    delete space;
+    ConversionReport report;
+    report.maxNormalizedError=0;
+    for(int c=0;c<3;c++){
+        ChannelError& channel=report.channels[c];
+        channel=total.channels[c];
+        channel.meanError= total.compared[c]>0 ? channel.meanError/total.compared[c] : 0.;
+        report.maxNormalizedError=max(report.maxNormalizedError,channel.maxError*fabs(scale[c]));
+    }
+    return report;
+}
+
+/**
+ * @brief validateConversion compare the batch conversion of packed 8 bits
+ * colors (see convertPacked) to the reference (see compareToReference), on the
+ * 2^24 8 bits rgb colors
+ *
+ * Colors are swept by blocks on all the cores, each block with its own color
+ * space.
+ *
+ * @param[in] spaceIndex see createColorspace
+ * @return differences, Real gives the precision of the batch conversion
+ */
+template<typename Real>
+ConversionReport validateConversion(int spaceIndex){
+    const size_t blockSize=2048;
+    return compareToReference<Real>(spaceIndex,size_t(1)<<24,blockSize,true,
+                                    [spaceIndex](size_t first, size_t n, double* rgb, Real* c1, Real* c2, Real* c3){
+        uint32_t keys[blockSize];
+        for(size_t i=0;i<n;i++){
+            keys[i]=uint32_t(first+i);
+            rgb[3*i]=(keys[i]>>16) & 0xff;
+            rgb[3*i+1]=(keys[i]>>8) & 0xff;
+            rgb[3*i+2]=keys[i] & 0xff;
+        }
+        ColorspaceInterface* fast=createColorspace(spaceIndex);
+        convertPacked(*fast,keys,n,c1,c2,c3,false);
+        delete fast;
+    });
+}
+
+/**
+ * @brief validateBufferConversion compare the batch conversion of 16 bits
+ * buffers (see convertBufferToPlanes) to the reference (see compareToReference)
+ *
+ * Each 8 bits color is swept 5 times : once scaled to 16 bits (*257), then
+ * with each channel moved by -2 to 2, so 16 bits values between the 8 bits
+ * ones are checked too. The reference gets the same scaled values than the
+ * conversion (see RGBDepth).
+ *
+ * @param[in] spaceIndex see createColorspace
+ * @return differences, Real gives the precision of the batch conversion
+ */
+template<typename Real>
+ConversionReport validateBufferConversion(int spaceIndex){
+    const size_t blockSize=2048;
+    return compareToReference<Real>(spaceIndex,size_t(5)<<24,blockSize,true,
+                                    [spaceIndex](size_t first, size_t n, double* rgb, Real* c1, Real* c2, Real* c3){
+        unsigned short values[3*blockSize];
+        const double scale=RGBDepth<unsigned short>::scale();
+        for(size_t i=0;i<n;i++){
+            size_t index=first+i;
+            size_t pass=index>>24;
+            uint32_t key=uint32_t(index & 0xffffff);
+            for(int c=0;c<3;c++){
+                int value=257*int((key>>(16-8*c)) & 0xff);
+                //the first pass is the 8 bits cube, then each channel gets its own move
+                int move= pass==0 ? 0 : int((pass+c+key)%5)-2;
+                values[3*i+c]=(unsigned short)(min(65535,max(0,value+move)));
+                rgb[3*i+c]=values[3*i+c]*scale;
+            }
+        }
+        ColorspaceInterface* fast=createColorspace(spaceIndex);
+        convertBufferToPlanes(*fast,values,n,c1,c2,c3,false);
+        delete fast;
+    });
+}
+
+}
+#endif // CONVERSIONVALIDATION_H
@@ -0,0 +1,663 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+#include "colorbitset.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The Point3 struct a point of the hull
+ */
+struct Point3{
+    double x;
+    double y;
+    double z;
+};
+
+/**
+ * @brief computePlane plane of a triangle
+ * @param[in] a
+ * @param[in] b
+ * @param[in] c
+ * @param[out] normal unit normal, toward the side from which a,b,c is counter clockwise
+ * @param[out] offset distance of the plane to the origin
+ * @return false if the triangle is degenerate (normal is null)
+ */
+inline bool computePlane(const Point3& a, const Point3& b, const Point3& c, Point3& normal, double& offset){
+    double ux=b.x-a.x, uy=b.y-a.y, uz=b.z-a.z;
+    double wx=c.x-a.x, wy=c.y-a.y, wz=c.z-a.z;
+    normal.x=uy*wz-uz*wy;
+    normal.y=uz*wx-ux*wz;
+    normal.z=ux*wy-uy*wx;
+    double length=sqrt(normal.x*normal.x+normal.y*normal.y+normal.z*normal.z);
+    if(length>0){
+        normal.x/=length;
+        normal.y/=length;
+        normal.z/=length;
+    }
+    offset=normal.x*a.x+normal.y*a.y+normal.z*a.z;
+    return length>0;
+}
+
+/**
+ * @brief The QuickHull class 3D convex hull of a set of points (quickhull algorithm)
+ *
+ * Each face keeps the points above it (its outside set). The furthest point of
+ * a face is added to the hull : faces it can see are removed and the hole is
+ * closed by a fan of faces from the point to the horizon. Faces are linked by
+ * their directed edges, so the visible faces are found by walking from the
+ * face, never by testing the whole hull.
+ */
+class QuickHull{
+public:
+    /**
+     * @brief QuickHull
+     * @param[in] points points of the set, must outlive the QuickHull
+     */
+    QuickHull(const vector<Point3>& points): points(points), eps(0){
+    }
+
+    /**
+     * @brief build compute the hull
+     * @param[out] triangles 3 indexes in points by face, counter clockwise seen from outside
+     * @return false if all the points are coplanar (flat hull, no volume)
+     */
+    bool build(vector<uint32_t>& triangles){
+        triangles.clear();
+        faces.clear();
+        edges.clear();
+        if(!createSimplex()){
+            return false;
+        }
+        for(size_t f=0;f<faces.size();f++){
+            if(faces[f].alive && !faces[f].outside.empty()){
+                addPoint(uint32_t(f));
+            }
+        }
+        for(size_t f=0;f<faces.size();f++){
+            if(faces[f].alive){
+                triangles.insert(triangles.end(),faces[f].v,faces[f].v+3);
+            }
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief The Face struct a triangle of the hull and the points above it
+     */
+    struct Face{
+        uint32_t v[3];/*!< vertices, counter clockwise seen from outside*/
+        Point3 normal;/*!< unit outward normal*/
+        double offset;/*!< distance of the plane to the origin*/
+        vector<uint32_t> outside;/*!< points above the face, not yet on the hull*/
+        uint32_t furthest;/*!< point of outside with the largest distance*/
+        double furthestDistance;
+        bool alive;/*!< false once the face is removed from the hull*/
+        int state;/*!< while adding a point : UNTESTED, VISIBLE or HIDDEN*/
+    };
+    enum{UNTESTED,VISIBLE,HIDDEN};
+
+    static uint64_t edgeKey(uint32_t a, uint32_t b){
+        return (uint64_t(a)<<32) | b;
+    }
+
+    double distance(const Face& face, uint32_t p) const{
+        const Point3& q=points[p];
+        return face.normal.x*q.x+face.normal.y*q.y+face.normal.z*q.z-face.offset;
+    }
+
+    /**
+     * @brief addFace create a face and register its edges
+     * @return index of the face
+     */
+    uint32_t addFace(uint32_t a, uint32_t b, uint32_t c){
+        Face face;
+        face.v[0]=a;
+        face.v[1]=b;
+        face.v[2]=c;
+        computePlane(points[a],points[b],points[c],face.normal,face.offset);
+        face.furthest=0;
+        face.furthestDistance=0;
+        face.alive=true;
+        face.state=UNTESTED;
+        uint32_t index=uint32_t(faces.size());
+        faces.push_back(face);
+        edges[edgeKey(a,b)]=index;
+        edges[edgeKey(b,c)]=index;
+        edges[edgeKey(c,a)]=index;
+        return index;
+    }
+
+    /**
+     * @brief assign give a point to the first face of [first;end[ it is above
+     * @return false if the point is below all these faces
+     */
+    bool assign(uint32_t p, size_t first){
+        for(size_t f=first;f<faces.size();f++){
+            Face& face=faces[f];
+            double d=distance(face,p);
+            if(d>eps){
+                face.outside.push_back(p);
+                if(d>face.furthestDistance){
+                    face.furthestDistance=d;
+                    face.furthest=p;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief createSimplex create the first tetrahedron from extreme points
+     * and share the other points between its faces
+     * @return false if points are coplanar
+     */
+    bool createSimplex(){
+        if(points.size()<4){
+            return false;
+        }
+        //extreme points along each axis
+        uint32_t extremes[6]={0,0,0,0,0,0};
+        for(uint32_t i=1;i<points.size();i++){
+            const Point3& p=points[i];
+            if(p.x<points[extremes[0]].x) extremes[0]=i;
+            if(p.x>points[extremes[1]].x) extremes[1]=i;
+            if(p.y<points[extremes[2]].y) extremes[2]=i;
+            if(p.y>points[extremes[3]].y) extremes[3]=i;
+            if(p.z<points[extremes[4]].z) extremes[4]=i;
+            if(p.z>points[extremes[5]].z) extremes[5]=i;
+        }
+        double extent=max(max(points[extremes[1]].x-points[extremes[0]].x,
+                              points[extremes[3]].y-points[extremes[2]].y),
+                          points[extremes[5]].z-points[extremes[4]].z);
+        eps=1e-10*max(extent,1.);
+
+        //two most distant extremes
+        uint32_t i0=extremes[0], i1=extremes[1];
+        double best=-1;
+        for(int a=0;a<6;a++){
+            for(int b=a+1;b<6;b++){
+                double d=squaredDistance(points[extremes[a]],points[extremes[b]]);
+                if(d>best){
+                    best=d;
+                    i0=extremes[a];
+                    i1=extremes[b];
+                }
+            }
+        }
+        if(best<=eps*eps){
+            return false;
+        }
+
+        //point furthest from the line (i0,i1)
+        const Point3& p0=points[i0];
+        const Point3& p1=points[i1];
+        double dx=p1.x-p0.x, dy=p1.y-p0.y, dz=p1.z-p0.z;
+        uint32_t i2=0;
+        best=-1;
+        for(uint32_t i=0;i<points.size();i++){
+            const Point3& p=points[i];
+            double vx=p.x-p0.x, vy=p.y-p0.y, vz=p.z-p0.z;
+            double cx=vy*dz-vz*dy, cy=vz*dx-vx*dz, cz=vx*dy-vy*dx;
+            double d=cx*cx+cy*cy+cz*cz;
+            if(d>best){
+                best=d;
+                i2=i;
+            }
+        }
+        if(sqrt(best)<=eps*sqrt(dx*dx+dy*dy+dz*dz)){
+            return false;
+        }
+
+        //point furthest from the plane (i0,i1,i2)
+        uint32_t base=addFace(i0,i1,i2);
+        uint32_t i3=0;
+        best=-1;
+        double side=0;
+        for(uint32_t i=0;i<points.size();i++){
+            double d=distance(faces[base],i);
+            if(fabs(d)>best){
+                best=fabs(d);
+                side=d;
+                i3=i;
+            }
+        }
+        faces.clear();
+        edges.clear();
+        if(best<=eps){
+            return false;
+        }
+        //the fourth point must be below the first face
+        if(side>0){
+            swap(i1,i2);
+        }
+        addFace(i0,i1,i2);
+        addFace(i0,i3,i1);
+        addFace(i1,i3,i2);
+        addFace(i2,i3,i0);
+
+        for(uint32_t i=0;i<points.size();i++){
+            if(i!=i0 && i!=i1 && i!=i2 && i!=i3){
+                assign(i,0);
+            }
+        }
+        return true;
+    }
+
+    static double squaredDistance(const Point3& a, const Point3& b){
+        return (a.x-b.x)*(a.x-b.x)+(a.y-b.y)*(a.y-b.y)+(a.z-b.z)*(a.z-b.z);
+    }
+
+    /**
+     * @brief addPoint add the furthest point of a face to the hull
+     * @param[in] start face with a non empty outside set
+     */
+    void addPoint(uint32_t start){
+        uint32_t eye=faces[start].furthest;
+
+        //walk from start over the faces seen by eye, the horizon is made of
+        //the edges between a visible face and a hidden one
+        vector<uint32_t> visible(1,start);
+        vector<uint32_t> horizon;
+        vector<uint32_t> hidden;
+        faces[start].state=VISIBLE;
+        for(size_t i=0;i<visible.size();i++){
+            const Face& face=faces[visible[i]];
+            for(int k=0;k<3;k++){
+                uint32_t a=face.v[k];
+                uint32_t b=face.v[(k+1)%3];
+                Face& neighbour=faces[edges[edgeKey(b,a)]];
+                if(neighbour.state==UNTESTED){
+                    if(distance(neighbour,eye)>eps){
+                        neighbour.state=VISIBLE;
+                        visible.push_back(edges[edgeKey(b,a)]);
+                    }else{
+                        neighbour.state=HIDDEN;
+                        hidden.push_back(edges[edgeKey(b,a)]);
+                    }
+                }
+                if(neighbour.state==HIDDEN){
+                    horizon.push_back(a);
+                    horizon.push_back(b);
+                }
+            }
+        }
+        for(size_t i=0;i<hidden.size();i++){
+            faces[hidden[i]].state=UNTESTED;
+        }
+
+        //remove visible faces, keeping their points
+        vector<uint32_t> orphans;
+        for(size_t i=0;i<visible.size();i++){
+            Face& face=faces[visible[i]];
+            face.alive=false;
+            orphans.insert(orphans.end(),face.outside.begin(),face.outside.end());
+            vector<uint32_t>().swap(face.outside);
+            for(int k=0;k<3;k++){
+                edges.erase(edgeKey(face.v[k],face.v[(k+1)%3]));
+            }
+        }
+
+        //close the hole with a fan from eye to the horizon
+        size_t first=faces.size();
+        for(size_t i=0;i<horizon.size();i+=2){
+            addFace(horizon[i],horizon[i+1],eye);
+        }
+        for(size_t i=0;i<orphans.size();i++){
+            if(orphans[i]!=eye){
+                assign(orphans[i],first);
+            }
+        }
+    }
+
+    const vector<Point3>& points;/*!< points of the set*/
+    vector<Face> faces;/*!< faces of the hull, alive or removed*/
+    unordered_map<uint64_t,uint32_t> edges;/*!< face of each directed edge (a<<32|b)*/
+    double eps;/*!< distance under which a point is on a plane*/
+};
+
+/**
+ * @brief The ConvexHull class convex hull of the normalized coordinates of a
+ * color cloud, its volume and its area
+ *
+ * Points inside the polytope of the extreme points are first dropped in
+ * parallel (see dropInterior). Large remaining sets are split in one chunk by
+ * thread : the hull of each chunk is computed in parallel, then the hull of the
+ * chunk hulls vertices gives the hull of the whole set.
+ */
+class ConvexHull{
+public:
+    ConvexHull(): volume(0), area(0){
+    }
+
+    /**
+     * @brief compute compute the hull of a set of points given by planes
+     * @param[in] x first coordinate of each point
+     * @param[in] y second coordinate of each point
+     * @param[in] z third coordinate of each point
+     * @param[in] count number of points
+     */
+    void compute(const float* x, const float* y, const float* z, size_t count){
+        vertices.clear();
+        triangles.clear();
+        volume=0;
+        area=0;
+
+        vector<Point3> candidates;
+        dropInterior(x,y,z,count,candidates);
+
+        size_t chunks=min<size_t>(threadCount(),candidates.size()/chunkMinSize);
+        if(chunks>1){
+            //hull of each chunk, in parallel
+            vector<vector<Point3> > chunkVertices(chunks);
+            size_t chunkSize=(candidates.size()+chunks-1)/chunks;
+            parallelFor(0,chunks,[&](size_t c){
+                size_t first=c*chunkSize;
+                size_t last=min(candidates.size(),first+chunkSize);
+                vector<Point3> chunk(candidates.begin()+first,candidates.begin()+last);
+                vector<uint32_t> chunkTriangles;
+                if(QuickHull(chunk).build(chunkTriangles)){
+                    keepVertices(chunk,chunkTriangles,chunkVertices[c]);
+                }else{
+                    //flat chunk : all its points are kept
+                    chunkVertices[c].swap(chunk);
+                }
+            });
+            candidates.clear();
+            for(size_t c=0;c<chunks;c++){
+                candidates.insert(candidates.end(),chunkVertices[c].begin(),chunkVertices[c].end());
+            }
+        }
+
+        vector<uint32_t> hull;
+        if(!QuickHull(candidates).build(hull)){
+            return;
+        }
+        keepVertices(candidates,hull,vertices,&triangles);
+
+        for(size_t t=0;t<triangles.size();t+=3){
+            const Point3& a=vertices[triangles[t]];
+            const Point3& b=vertices[triangles[t+1]];
+            const Point3& c=vertices[triangles[t+2]];
+            //signed volume of the tetrahedron (origin,a,b,c)
+            volume+=(a.x*(b.y*c.z-b.z*c.y)-a.y*(b.x*c.z-b.z*c.x)+a.z*(b.x*c.y-b.y*c.x))/6.;
+            double ux=b.x-a.x, uy=b.y-a.y, uz=b.z-a.z;
+            double wx=c.x-a.x, wy=c.y-a.y, wz=c.z-a.z;
+            double nx=uy*wz-uz*wy, ny=uz*wx-ux*wz, nz=ux*wy-uy*wx;
+            area+=sqrt(nx*nx+ny*ny+nz*nz)/2.;
+        }
+    }
+
+    /**
+     * @brief getVertices
+     * @return vertices of the hull
+     */
+    const vector<Point3>& getVertices() const{
+        return vertices;
+    }
+
+    /**
+     * @brief getTriangles
+     * @return 3 indexes in getVertices() by face, counter clockwise seen from outside
+     */
+    const vector<uint32_t>& getTriangles() const{
+        return triangles;
+    }
+
+    /**
+     * @brief getVolume
+     * @return volume of the hull, 0 if the points are coplanar
+     */
+    double getVolume() const{
+        return volume;
+    }
+
+    /**
+     * @brief getArea
+     * @return area of the hull surface
+     */
+    double getArea() const{
+        return area;
+    }
+
+    bool empty() const{
+        return triangles.empty();
+    }
+
+private:
+    static const size_t chunkMinSize=16384;/*!< smaller sets are not split*/
+    static const size_t blockSize=65536;/*!< points by block of the parallel filter*/
+    static const size_t sampleSize=65536;/*!< points used to find the filter polytope*/
+    static const int DIRECTION_COUNT=26;/*!< axes, face and cube diagonals, both ways*/
+    static const size_t CELLS=32;/*!< cells along each axis of the filter grid*/
+
+    /**
+     * @brief dropInterior keep the points that may be on the hull
+     *
+     * Points of a sample extreme along the axes and the diagonals span a
+     * polytope inside the hull. Points strictly inside it can't be on the hull. The bounding box is
+     * divided in cells : a cell inside the polytope drops its points with a
+     * single lookup, only points of the other cells are tested against the
+     * planes. Points with a NaN or infinite coordinate are dropped too.
+     *
+     * @param[in] x first coordinate of each point
+     * @param[in] y second coordinate of each point
+     * @param[in] z third coordinate of each point
+     * @param[in] count number of points
+     * @param[out] kept remaining points
+     */
+    static void dropInterior(const float* x, const float* y, const float* z, size_t count,
+                             vector<Point3>& kept){
+        static const double directions[DIRECTION_COUNT][3]={
+            {1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1},
+            {1,1,0},{-1,-1,0},{1,-1,0},{-1,1,0},{1,0,1},{-1,0,-1},
+            {1,0,-1},{-1,0,1},{0,1,1},{0,-1,-1},{0,1,-1},{0,-1,1},
+            {1,1,1},{-1,-1,-1},{1,1,-1},{-1,-1,1},{1,-1,1},{-1,1,-1},{-1,1,1},{1,-1,-1}};
+        size_t blocks=(count+blockSize-1)/blockSize;
+
+        //any points of the set span a polytope inside the hull : extremes of
+        //a sample are enough, and far cheaper than extremes of the whole set
+        size_t samples=min(count,sampleSize);
+        vector<Point3> extremes;
+        double best[DIRECTION_COUNT];
+        for(size_t j=0;j<samples;j++){
+            //scattered indexes : a regular stride may only see a slice of sorted colors
+            size_t i= samples==count ? j : size_t(uint64_t(j)*2654435761u%count);
+            if(!isfinite(x[i]) || !isfinite(y[i]) || !isfinite(z[i])){
+                continue;
+            }
+            Point3 p={x[i],y[i],z[i]};
+            if(extremes.empty()){
+                extremes.assign(DIRECTION_COUNT,p);
+                for(int d=0;d<DIRECTION_COUNT;d++){
+                    best[d]=directions[d][0]*p.x+directions[d][1]*p.y+directions[d][2]*p.z;
+                }
+            }
+            for(int d=0;d<DIRECTION_COUNT;d++){
+                double v=directions[d][0]*p.x+directions[d][1]*p.y+directions[d][2]*p.z;
+                if(v>best[d]){
+                    best[d]=v;
+                    extremes[d]=p;
+                }
+            }
+        }
+
+        //planes of the polytope, empty if it is flat
+        vector<uint32_t> polytope;
+        vector<Point3> normals;
+        vector<double> offsets;
+        if(QuickHull(extremes).build(polytope)){
+            for(size_t t=0;t<polytope.size();t+=3){
+                Point3 normal;
+                double offset;
+                if(computePlane(extremes[polytope[t]],extremes[polytope[t+1]],extremes[polytope[t+2]],normal,offset)){
+                    normals.push_back(normal);
+                    offsets.push_back(offset);
+                }
+            }
+        }
+
+        //cells fully inside the polytope : their 8 corners are inside
+        vector<char> insideCell(CELLS*CELLS*CELLS,0);
+        double low[3]={0,0,0};
+        double cellSize[3]={1,1,1};
+        double cellScale[3]={1,1,1};
+        if(!normals.empty()){
+            //extremes along -x, -y and -z
+            low[0]=extremes[1].x;
+            low[1]=extremes[3].y;
+            low[2]=extremes[5].z;
+            cellSize[0]=(extremes[0].x-low[0])/CELLS;
+            cellSize[1]=(extremes[2].y-low[1])/CELLS;
+            cellSize[2]=(extremes[4].z-low[2])/CELLS;
+            for(int k=0;k<3;k++){
+                cellScale[k]= cellSize[k]>0 ? 1./cellSize[k] : 0.;
+            }
+            for(size_t c=0;c<insideCell.size();c++){
+                size_t cx=c%CELLS, cy=(c/CELLS)%CELLS, cz=c/(CELLS*CELLS);
+                bool inside=true;
+                for(int k=0;k<8 && inside;k++){
+                    Point3 corner={low[0]+(cx+(k&1))*cellSize[0],
+                                   low[1]+(cy+((k>>1)&1))*cellSize[1],
+                                   low[2]+(cz+((k>>2)&1))*cellSize[2]};
+                    inside=isInside(corner,normals,offsets);
+                }
+                insideCell[c]=inside;
+            }
+        }
+
+        vector<vector<Point3> > blockKept(blocks);
+        parallelForBlocks(0,count,blockSize,[&](size_t first, size_t last){
+            vector<Point3>& out=blockKept[first/blockSize];
+            for(size_t i=first;i<last;i++){
+                if(!isfinite(x[i]) || !isfinite(y[i]) || !isfinite(z[i])){
+                    continue;
+                }
+                Point3 p={x[i],y[i],z[i]};
+                if(!normals.empty()){
+                    size_t cx=min(size_t(max((p.x-low[0])*cellScale[0],0.)),CELLS-1);
+                    size_t cy=min(size_t(max((p.y-low[1])*cellScale[1],0.)),CELLS-1);
+                    size_t cz=min(size_t(max((p.z-low[2])*cellScale[2],0.)),CELLS-1);
+                    if(insideCell[(cz*CELLS+cy)*CELLS+cx] || isInside(p,normals,offsets)){
+                        continue;
+                    }
+                }
+                out.push_back(p);
+            }
+        });
+        kept.clear();
+        for(size_t b=0;b<blocks;b++){
+            kept.insert(kept.end(),blockKept[b].begin(),blockKept[b].end());
+        }
+    }
+
+    /**
+     * @brief isInside test if a point is strictly inside a convex polytope
+     * @param[in] p
+     * @param[in] normals outward normals of the polytope faces
+     * @param[in] offsets distances of the faces to the origin
+     */
+    static bool isInside(const Point3& p, const vector<Point3>& normals, const vector<double>& offsets){
+        for(size_t f=0;f<normals.size();f++){
+            if(normals[f].x*p.x+normals[f].y*p.y+normals[f].z*p.z-offsets[f]>=-1e-9){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief keepVertices copy the points used by a triangulation
+     * @param[in] points
+     * @param[in] used 3 indexes in points by triangle
+     * @param[out] kept points used, each one once
+     * @param[out] reindexed if not NULL, used with indexes in kept
+     */
+    static void keepVertices(const vector<Point3>& points, const vector<uint32_t>& used,
+                             vector<Point3>& kept, vector<uint32_t>* reindexed=NULL){
+        unordered_map<uint32_t,uint32_t> index;
+        kept.clear();
+        if(reindexed!=NULL){
+            reindexed->resize(used.size());
+        }
+        for(size_t i=0;i<used.size();i++){
+            auto it=index.find(used[i]);
+            uint32_t k;
+            if(it==index.end()){
+                k=uint32_t(kept.size());
+                index[used[i]]=k;
+                kept.push_back(points[used[i]]);
+            }else{
+                k=it->second;
+            }
+            if(reindexed!=NULL){
+                (*reindexed)[i]=k;
+            }
+        }
+    }
+
+    vector<Point3> vertices;/*!< vertices of the hull*/
+    vector<uint32_t> triangles;/*!< faces of the hull*/
+    double volume;/*!< volume enclosed by the hull*/
+    double area;/*!< area of the hull surface*/
+};
+
+/**
+ * @brief voxelOccupancy measure the volume filled by a set of points in [0;1]^3
+ *
+ * The cube is divided in resolution^3 voxels. Unlike the convex hull, holes
+ * and concavities of the gamut are not counted.
+ *
+ * @param[in] x first coordinate of each point, in [0;1]
+ * @param[in] y second coordinate of each point, in [0;1]
+ * @param[in] z third coordinate of each point, in [0;1]
+ * @param[in] count number of points, the ones with a non finite coordinate are skipped
+ * @param[in] resolution number of voxels along each axis
+ * @return fraction ([0;1]) of the voxels containing at least one point
+ */
+inline double voxelOccupancy(const float* x, const float* y, const float* z, size_t count,
+                             unsigned int resolution=64){
+    const size_t voxels=size_t(resolution)*resolution*resolution;
+    const size_t words=(voxels+63)/64;
+    //each block marks its own grid, kept until the grids are merged : 32 blocks
+    //at most, enough for the cores without holding a grid by 65536 points
+    size_t blockSize=max<size_t>(size_t(1)<<16,(count+31)/32);
+    vector<uint64_t> occupied=parallelReduce(0,count,blockSize,vector<uint64_t>(words,0),[&](size_t first, size_t last)->vector<uint64_t>{
+        vector<uint64_t> local(words,0);
+        const float r=float(resolution);
+        for(size_t i=first;i<last;i++){
+            //NaN coordinates (undefined chromaticity of black) are not in a voxel
+            if(!isfinite(x[i]) || !isfinite(y[i]) || !isfinite(z[i])){
+                continue;
+            }
+            //clamped before the cast, out of range floats can't be converted
+            size_t vx=min<size_t>(size_t(min(max(x[i],0.f),1.f)*r),resolution-1);
+            size_t vy=min<size_t>(size_t(min(max(y[i],0.f),1.f)*r),resolution-1);
+            size_t vz=min<size_t>(size_t(min(max(z[i],0.f),1.f)*r),resolution-1);
+            size_t v=(vz*resolution+vy)*resolution+vx;
+            local[v>>6]|=uint64_t(1)<<(v&63);
+        }
+        return local;
+    },[words](vector<uint64_t> merged, const vector<uint64_t>& local)->vector<uint64_t>{
+        for(size_t w=0;w<words;w++){
+            merged[w]|=local[w];
+        }
+        return merged;
+    });
+    size_t filled=0;
+    for(size_t w=0;w<words;w++){
+        filled+=popcount(occupied[w]);
+    }
+    return double(filled)/double(voxels);
+}
+
+}
+#endif // CONVEXHULL_H
@@ -0,0 +1,89 @@
+#ifndef DENSECOLORCOUNTER_H
+#define DENSECOLORCOUNTER_H
+#include "colorcloud.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+/**
+ * @brief The DenseColorCounter class count occurences of 8 bits rgb colors
+ *
+ * One counter by possible color (2^24 counters, 64MB), allocated once. Counting
+ * is a single increment per pixel, without hashing nor sorting.
+ */
+class DenseColorCounter{
+public:
+    DenseColorCounter(): distinct(0){
+    }
+
+    /**
+     * @brief addPixels count colors of a pixels buffer
+     *
+     * Channels after the third one (alpha) are ignored. With one or two channels
+     * the first one is used as a gray level.
+     *
+     * @param[in] data interleaved pixels values
+     * @param[in] pixelCount number of pixels in the buffer
+     * @param[in] channels number of channels per pixel
+     */
+    void addPixels(const unsigned char* data, size_t pixelCount, size_t channels){
+        if(counts.empty()){
+            counts.assign(size_t(1)<<24,0);
+        }
+        for(size_t i=0;i<pixelCount;i++){
+            const unsigned char* p=data+i*channels;
+            uint32_t key= channels>=3 ? pack(p[0],p[1],p[2]) : pack(p[0],p[0],p[0]);
+            if(counts[key]++==0){
+                distinct++;
+            }
+        }
+    }
+
+    /**
+     * @brief size
+     * @return number of distinct colors
+     */
+    size_t size() const{
+        return distinct;
+    }
+
+    /**
+     * @brief extractColors move counted colors to a cloud, sorted by key
+     *
+     * Counters are reset while they are read, so the counter is ready for
+     * another image without clearing the whole table.
+     *
+     * @param[out] cloud keys and counts are filled, coordinates are not computed
+     */
+    void extractColors(ColorCloud& cloud){
+        cloud.reserve(distinct);
+        cloud.resize(distinct);
+        uint32_t* keys=cloud.keys();
+        uint32_t* occurences=cloud.counts();
+        size_t n=0;
+        for(uint32_t key=0;key<counts.size() && n<distinct;key++){
+            if(counts[key]!=0){
+                keys[n]=key;
+                occurences[n]=counts[key];
+                counts[key]=0;
+                n++;
+            }
+        }
+        distinct=0;
+    }
+
+    /**
+     * @brief pack pack a 8 bits rgb color in a 24 bits key (0xRRGGBB)
+     */
+    static uint32_t pack(unsigned char red, unsigned char green, unsigned char blue){
+        return (uint32_t(red)<<16) | (uint32_t(green)<<8) | uint32_t(blue);
+    }
+
+private:
+    vector<uint32_t> counts;/*!< number of pixels by packed color*/
+    size_t distinct;/*!< number of non zero counters*/
+};
+}
+#endif // DENSECOLORCOUNTER_H
@@ -0,0 +1,165 @@
+#ifndef DENSITYGRID_H
+#define DENSITYGRID_H
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The DensityGrid class 3D histogram of weighted colored points of [0;1]^3
+ *
+ * Each cell holds the total weight of its points (the number of pixels of
+ * their colors) and their mean display color. The cost of drawing the grid
+ * doesn't depend on the number of points.
+ *
+ * Built in parallel : each chunk of points is binned in its own grid, then the
+ * grids are summed cell by cell, also in parallel.
+ */
+class DensityGrid{
+public:
+    /**
+     * @brief CHANNELS values by cell : weight, then weighted sum (mean once
+     * built) of red, green and blue
+     */
+    static const size_t CHANNELS=4;
+
+    DensityGrid(): resolution(0), maxWeight(0){
+    }
+
+    /**
+     * @brief build bin the points
+     *
+     * Points out of [0;1]^3 are clamped in the border cells, NaN points are left out.
+     *
+     * @param[in] x first coordinate of each point
+     * @param[in] y second coordinate of each point
+     * @param[in] z third coordinate of each point
+     * @param[in] weights weight of each point
+     * @param[in] colors packed (0xRRGGBB) display color of each point
+     * @param[in] count number of points
+     * @param[in] resolution number of cells along each axis
+     */
+    void build(const float* x, const float* y, const float* z, const uint32_t* weights, const uint32_t* colors,
+               size_t count, int resolution=128){
+        this->resolution=resolution;
+        size_t cellCount=size_t(resolution)*resolution*resolution;
+
+        //a grid by chunk of points, only for clouds large enough to pay for it
+        size_t chunks=max<size_t>(1,min<size_t>(threadCount(),count/chunkMinSize));
+        size_t chunkSize=(count+chunks-1)/chunks;
+        vector<vector<float> > grids(chunks);
+        parallelFor(0,chunks,[&](size_t c){
+            vector<float>& grid=grids[c];
+            grid.assign(CHANNELS*cellCount,0.f);
+            size_t first=min(count,c*chunkSize);
+            size_t last=min(count,first+chunkSize);
+            for(size_t i=first;i<last;i++){
+                if(x[i]!=x[i] || y[i]!=y[i] || z[i]!=z[i]){
+                    continue;
+                }
+                float* cell=&grid[CHANNELS*cellIndex(cellCoordinate(x[i]),cellCoordinate(y[i]),cellCoordinate(z[i]))];
+                float w=float(weights[i]);
+                cell[0]+=w;
+                cell[1]+=w*float((colors[i]>>16) & 0xff);
+                cell[2]+=w*float((colors[i]>>8) & 0xff);
+                cell[3]+=w*float(colors[i] & 0xff);
+            }
+        });
+
+        //reduction in the first grid, then mean colors
+        cells.swap(grids[0]);
+        vector<float> blockMax((cellCount+blockSize-1)/blockSize,0.f);
+        parallelForBlocks(0,cellCount,blockSize,[&](size_t first, size_t last){
+            float m=0;
+            for(size_t c=first;c<last;c++){
+                float* cell=&cells[CHANNELS*c];
+                for(size_t g=1;g<chunks;g++){
+                    const float* other=&grids[g][CHANNELS*c];
+                    for(size_t k=0;k<CHANNELS;k++){
+                        cell[k]+=other[k];
+                    }
+                }
+                if(cell[0]>0){
+                    cell[1]/=cell[0];
+                    cell[2]/=cell[0];
+                    cell[3]/=cell[0];
+                }
+                m=max(m,cell[0]);
+            }
+            blockMax[first/blockSize]=m;
+        });
+        maxWeight=*max_element(blockMax.begin(),blockMax.end());
+    }
+
+    /**
+     * @brief toRGBA cells as an 8 bits rgba volume, x varying first
+     *
+     * rgb is the mean color, alpha the weight on a log scale : a few pixels
+     * stay visible next to millions.
+     *
+     * @param[out] rgba 4 values by cell
+     */
+    void toRGBA(vector<unsigned char>& rgba) const{
+        size_t cellCount=cells.size()/CHANNELS;
+        rgba.resize(4*cellCount);
+        float scale= maxWeight>0 ? 255.f/log1p(maxWeight) : 0.f;
+        parallelForBlocks(0,cellCount,blockSize,[&](size_t first, size_t last){
+            for(size_t c=first;c<last;c++){
+                const float* cell=&cells[CHANNELS*c];
+                unsigned char* out=&rgba[4*c];
+                out[0]=(unsigned char)(cell[1]+0.5f);
+                out[1]=(unsigned char)(cell[2]+0.5f);
+                out[2]=(unsigned char)(cell[3]+0.5f);
+                out[3]=(unsigned char)(log1p(cell[0])*scale+0.5f);
+            }
+        });
+    }
+
+    int getResolution() const{
+        return resolution;
+    }
+    /**
+     * @brief getCells
+     * @return CHANNELS values by cell, x varying first, then y, then z
+     */
+    const vector<float>& getCells() const{
+        return cells;
+    }
+    /**
+     * @brief getMaxWeight
+     * @return weight of the heaviest cell
+     */
+    float getMaxWeight() const{
+        return maxWeight;
+    }
+
+private:
+    static const size_t chunkMinSize=size_t(1)<<20;/*!< points by chunk worth a grid*/
+    static const size_t blockSize=size_t(1)<<14;/*!< cells by block of the reduction*/
+
+    /**
+     * @brief cellCoordinate
+     * @param[in] v coordinate in [0;1]
+     * @return index of the cell along an axis, clamped to the grid
+     */
+    int cellCoordinate(float v) const{
+        int c=int(v*resolution);
+        return min(max(c,0),resolution-1);
+    }
+
+    size_t cellIndex(int i, int j, int k) const{
+        return (size_t(k)*resolution+j)*resolution+i;
+    }
+
+    int resolution;/*!< number of cells along each axis*/
+    vector<float> cells;/*!< weight and color of each cell*/
+    float maxWeight;/*!< weight of the heaviest cell*/
+};
+
+}
+#endif // DENSITYGRID_H
@@ -0,0 +1,151 @@
+#ifndef GAMUTCOMPARISON_H
+#define GAMUTCOMPARISON_H
+#include "colorbitset.h"
+#include <string>
+
+namespace cs{
+
+/**
+ * @brief The GamutComparison class compare the colors of several images
+ *
+ * Each image (source) is a ColorBitset. Results are the colors of :
+ *  + UNION : at least one source
+ *  + INTERSECTION : all the sources
+ *  + EXCLUSIVE : exactly one source (colors unique to each source)
+ *
+ * For each resulting color, the comparison also tells which source owns it
+ * (SHARED if several sources have it) and in how many sources it is.
+ */
+class GamutComparison{
+public:
+    enum Operation{UNION,INTERSECTION,EXCLUSIVE,OPERATION_COUNT};
+    static const uint32_t SHARED=0xffffffffu;/*!< owner of colors in several sources*/
+
+    /**
+     * @brief getOperationName
+     * @param op
+     * @return name of the operation, for display
+     */
+    static string getOperationName(Operation op){
+        switch(op){
+        case UNION:
+            return "union";
+        case INTERSECTION:
+            return "intersection";
+        case EXCLUSIVE:
+            return "unique to each image";
+        default:
+            return "";
+        }
+    }
+
+    /**
+     * @brief setSourceCount remove all sources and create n empty ones
+     * @param n
+     */
+    void setSourceCount(size_t n){
+        sources.clear();
+        sources.resize(n);
+    }
+
+    size_t getSourceCount() const{
+        return sources.size();
+    }
+
+    /**
+     * @brief removeSource remove source i, the next ones move down by one
+     * @param i
+     */
+    void removeSource(size_t i){
+        sources.erase(sources.begin()+i);
+    }
+
+    /**
+     * @brief getSource
+     * @param i
+     * @return colors of source i, sources can be filled in parallel
+     */
+    ColorBitset& getSource(size_t i){
+        return sources[i];
+    }
+
+    /**
+     * @brief compute compute an operation between all the sources
+     * @param[in] op
+     * @param[out] cloud resulting colors, counts are the number of sources having each color
+     * @param[out] owners for each color of the cloud, index of the only source having
+     * it, or SHARED
+     */
+    void compute(Operation op, ColorCloud& cloud, vector<uint32_t>& owners) const{
+        ColorBitset result;
+        if(!sources.empty()){
+            const size_t blockWords=4096;
+            uint64_t* r=result.getWords();
+            parallelForBlocks(0,ColorBitset::WORD_COUNT,blockWords,[&](size_t first, size_t last){
+                combine(op,r,first,last);
+            });
+        }
+        result.extractColors(cloud);
+
+        //owner and number of sources of each color
+        owners.resize(cloud.size());
+        const uint32_t* keys=cloud.keys();
+        uint32_t* counts=cloud.counts();
+        parallelForBlocks(0,cloud.size(),16384,[&](size_t first, size_t last){
+            for(size_t i=first;i<last;i++){
+                uint32_t n=0;
+                uint32_t owner=SHARED;
+                for(size_t s=0;s<sources.size();s++){
+                    if(sources[s].contains(keys[i])){
+                        n++;
+                        owner=uint32_t(s);
+                    }
+                }
+                counts[i]=n;
+                owners[i]= n==1 ? owner : SHARED;
+            }
+        });
+    }
+
+private:
+    /**
+     * @brief combine apply an operation on words [first;last[ of all the sources
+     */
+    void combine(Operation op, uint64_t* r, size_t first, size_t last) const{
+        const uint64_t* w0=sources[0].getWords();
+        for(size_t i=first;i<last;i++){
+            r[i]=w0[i];
+        }
+        if(op==EXCLUSIVE){
+            //bits seen once (r) and at least twice (twice), word-wise
+            vector<uint64_t> twice(last-first,0);
+            for(size_t s=1;s<sources.size();s++){
+                const uint64_t* w=sources[s].getWords();
+                for(size_t i=first;i<last;i++){
+                    twice[i-first]|=r[i] & w[i];
+                    r[i]^=w[i];
+                }
+            }
+            for(size_t i=first;i<last;i++){
+                r[i]&=~twice[i-first];
+            }
+            return;
+        }
+        for(size_t s=1;s<sources.size();s++){
+            const uint64_t* w=sources[s].getWords();
+            if(op==UNION){
+                for(size_t i=first;i<last;i++){
+                    r[i]|=w[i];
+                }
+            }else{
+                for(size_t i=first;i<last;i++){
+                    r[i]&=w[i];
+                }
+            }
+        }
+    }
+
+    vector<ColorBitset> sources;/*!< colors of each image*/
+};
+}
+#endif // GAMUTCOMPARISON_H
@@ -33,39 +33,47 @@ public:
      */
     H1H2H3(unsigned int red=255,unsigned int green=255,unsigned int blue=255){
         name="H1H2H3";
-        c1Min=0.;
-        c2Min=-255.;
-        c3Min=-255.;
-        c1Max=510.;
-        c2Max=255.;
-        c3Max=255.;
+        setRanges(0.,510.,
+                  -255.,255.,
+                  -255.,255.);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief convertFromRGB convert from rgb to the H1H2H3 space
+    * @brief compute convert from rgb to H1H2H3 color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 H1 component
+    * @param[out] o2 H2 component
+    * @param[out] o3 H3 component
+    */
+    template<typename Real>
+    static void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3){
+        //convert from rgb to H1H2H3 color space
+        o1=red+green;
+        o2=red-green;
+        o3=blue-Real(0.5)*o1;
+    }
+
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to H1H2H3 color space
     * @param[in] r red in [0;255]
     * @param[in] g green in [0;255]
     * @param[in] b blue in [0;255]
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
-        //convert from rgb to H1H2H3 color space
-        c1=red+green;
-        c2=double(red)-double(green);
-        c3=double(blue)-0.5*c1;
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
     }
 
 
-
-
 };
 };
 #endif // H1H2H3_CLASSE
@@ -0,0 +1,86 @@
+#ifndef HALFFLOAT_H
+#define HALFFLOAT_H
+#include "batchconverter.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace cs{
+
+/**
+ * @brief floatToHalf convert a float to a IEEE 754 half float (binary16)
+ *
+ * Rounding is to nearest even. Overflow gives infinity, NaN stays NaN.
+ *
+ * @param[in] value
+ * @return half float bits
+ */
+inline uint16_t floatToHalf(float value){
+    uint32_t bits;
+    memcpy(&bits,&value,sizeof(bits));
+    uint16_t sign=uint16_t((bits>>16) & 0x8000u);
+    uint32_t absBits=bits & 0x7fffffffu;
+
+    if(absBits>=0x7f800000u){
+        //infinity or NaN
+        return sign | 0x7c00u | (absBits>0x7f800000u ? 0x200u : 0u);
+    }
+    if(absBits>=0x477ff000u){
+        //too big, rounded to infinity
+        return sign | 0x7c00u;
+    }
+    if(absBits<0x38800000u){
+        //subnormal half (or zero)
+        if(absBits<0x33000000u){
+            return sign;
+        }
+        uint32_t exponent=absBits>>23;
+        uint32_t mantissa=(absBits & 0x7fffffu) | 0x800000u;
+        uint32_t shift=126-exponent;
+        uint32_t half=mantissa>>shift;
+        uint32_t rest=mantissa & ((1u<<shift)-1);
+        uint32_t middle=1u<<(shift-1);
+        if(rest>middle || (rest==middle && (half & 1u))){
+            half++;
+        }
+        return sign | uint16_t(half);
+    }
+    //normal half : rebias exponent, round mantissa from 23 to 10 bits
+    uint32_t half=((absBits-0x38000000u)>>13);
+    uint32_t rest=absBits & 0x1fffu;
+    if(rest>0x1000u || (rest==0x1000u && (half & 1u))){
+        half++;
+    }
+    return sign | uint16_t(half);
+}
+
+/**
+ * @brief convertBufferToHalf convert a buffer of rgb colors, output as half floats
+ *
+ * Conversion is done in float (see convertBuffer) then packed to half floats,
+ * ready for a GL_HALF_FLOAT vertex buffer : four times less memory than the
+ * double path. Normalized values in [0;1] lose at most 2.5e-4 (half of the
+ * half float spacing in [0.5;1]).
+ *
+ * @param[in,out] space color space used for conversion
+ * @param[in] rgb interleaved red, green and blue values (depth given by T)
+ * @param[in] count number of colors in the buffer
+ * @param[out] out interleaved c1, c2 and c3 half floats, 3*count elements
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ */
+template<typename T>
+void convertBufferToHalf(ColorspaceInterface& space, const T* rgb, size_t count, uint16_t* out, bool normalized=false){
+    //convert by blocks to keep the float buffer in cache
+    const size_t blockSize=4096;
+    vector<float> block(3*blockSize);
+    for(size_t start=0;start<count;start+=blockSize){
+        size_t n=min(blockSize,count-start);
+        convertBuffer(space,rgb+3*start,n,block.data(),normalized);
+        for(size_t i=0;i<3*n;i++){
+            out[3*start+i]=floatToHalf(block[i]);
+        }
+    }
+}
+
+}
+#endif // HALFFLOAT_H
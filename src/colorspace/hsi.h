@@ -32,62 +32,70 @@ public:
      */
     HSI(unsigned int red=255, unsigned int green=255, unsigned int blue=255){
         name="hsi";
-        c1Min=0.;
-        c2Min=0.;
-        c3Min=0.;
-        c1Max=2*M_PI;
-        c2Max=1.;
-        c3Max=255.;
+        setRanges(0.,2*M_PI,
+                  0.,1.,
+                  0.,255.);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief convertFromRGB convert from RGB to HSI color space
-    * @param[in] r red in [0;255]
-    * @param[in] g green in [0;255]
-    * @param[in] b blue in [0;255]
+    * @brief compute convert from rgb to HSI color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 hue component
+    * @param[out] o2 saturation component
+    * @param[out] o3 intensity component
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
+    template<typename Real>
+    static void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3){
         bool grayLevel=(red==green) && (green==blue);
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
         //convert from rgb to HSI color space
-        c1=M_PI;
+        o1=Real(M_PI);
         if(!grayLevel){
-            double r_g=double(red)-double(green);
-            double r_b=double(red)-double(blue);
-            double g_b=double(green)-double(blue);
-            double n1=0.5*(r_g+r_b);
-            double n2=sqrt(pow(r_g,2)+r_b*g_b);
-            c1=acos(n1/n2);
+            Real r_g=red-green;
+            Real r_b=red-blue;
+            Real g_b=green-blue;
+            Real n1=Real(0.5)*(r_g+r_b);
+            Real n2=sqrt(r_g*r_g+r_b*g_b);
+            //rounding can put the ratio slightly out of [-1;1] near gray levels (16 bits inputs)
+            o1=acos(max(Real(-1),min(Real(1),n1/n2)));
             if(blue>green){
-                c1=2*M_PI-c1;
+                o1=Real(2*M_PI)-o1;
             }
 
         }
 
-        double sum_rgb=double(red)+double(green)+double(blue);
+        Real sum_rgb=red+green+blue;
 
-        c2=0;
+        o2=0;
         if(!grayLevel){
-            double min_rgb=min(red,min(green,blue));
-            c2=(3.*min_rgb)/sum_rgb;
-            c2=1.-c2;
+            Real min_rgb=min(red,min(green,blue));
+            o2=(Real(3)*min_rgb)/sum_rgb;
+            o2=Real(1)-o2;
         }
 
-        c3=sum_rgb;
-        c3/=3.;
+        o3=sum_rgb;
+        o3/=Real(3);
 
     }
 
-
-
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to HSI color space
+    * @param[in] r red in [0;255]
+    * @param[in] g green in [0;255]
+    * @param[in] b blue in [0;255]
+    */
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
+    }
 
 
 };
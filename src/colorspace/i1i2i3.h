@@ -33,38 +33,48 @@ public:
      */
     I1I2I3(unsigned int red=255, unsigned int green=255, unsigned int blue=255){
         name="i1i2i3";
-        c1Min=0.;
-        c2Min=-127.5;
-        c3Min=-127.5;
-        c1Max=255;
-        c2Max=127.5;
-        c3Max=127.5;
+        setRanges(0.,255,
+                  -127.5,127.5,
+                  -127.5,127.5);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief convertFromRGB cnvert from rgb to I1I2I3 color space
+    * @brief compute convert from rgb to I1I2I3 color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 I1 component
+    * @param[out] o2 I2 component
+    * @param[out] o3 I3 component
+    */
+    template<typename Real>
+    static void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3){
+        Real s_rgb=red+green+blue;
+
+        //convert from rgb to I1I2I3 color space
+        o1=s_rgb/Real(3);
+        o2=red-blue;
+        o2*=Real(0.5);
+        o3=Real(2)*red-green-blue;
+        o3*=Real(0.25);
+    }
+
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to I1I2I3 color space
     * @param[in] r red in [0;255]
     * @param[in] g green in [0;255]
     * @param[in] b blue in [0;255]
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
-        double s_rgb=red+green+blue;
-
-        //convert from rgb to I1I2I3 color space
-        c1=s_rgb/3.;
-        c2=double(red)-double(blue);
-        c2*=0.5;
-        c3=2.*double(red)-double(green)-double(blue);
-        c3*=0.25;
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
     }
 
 
@@ -39,74 +39,84 @@ public:
      */
     LAB(unsigned int red=255, unsigned int green=255, unsigned int blue=255){
         name="Lab";
-        c1Min=0.;
-        c2Min=-137.72;
-        c3Min=-99.23;
-        c1Max=100.;
-        c2Max=96.84;
-        c3Max=115.65;
+        setRanges(0.,100.,
+                  -137.72,96.84,
+                  -99.23,115.65);
+        XYZ::compute(255.,255.,255.,xb,yb,zb);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief createFromRGB cnvert from rgb to LAB color space
-    * @param[in] r red in [0;255]
-    * @param[in] g green in [0;255]
-    * @param[in] b blue in [0;255]
+    * @brief compute convert from rgb to LAB color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 l component
+    * @param[out] o2 a component
+    * @param[out] o3 b component
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
+    template<typename Real>
+    void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3) const{
         //convert from rgb to xyz color space
-        cs::XYZ xyz;
-
-        //reference white for default white (r=2555, v=255 and b=255)
-        double xb=xyz.getC1();
-        double yb=xyz.getC2();
-        double zb=xyz.getC3();
+        Real x,y,z;
+        XYZ::compute(red,green,blue,x,y,z);
 
-        xyz.convertFromRGB(red,green,blue);
+        Real l,a,b;
+        Real yr=y/Real(yb);
 
-        double l,a,b;
-        double yr=xyz.getC2()/yb;
-
-        if(yr>0.008856){
-            l=116*pow(yr,1./3.)-16;
+        if(yr>Real(0.008856)){
+            l=Real(116)*pow(yr,Real(1)/Real(3))-Real(16);
         }else{
-            l=903.3*yr;
+            l=Real(903.3)*yr;
         }
-        a=500*(f(xyz.getC1()/xb) - f(xyz.getC2()/yb) );
-        a=min(a,c2Max);
-        a=max(a,c2Min);
+        a=Real(500)*(f(x/Real(xb)) - f(y/Real(yb)) );
+        a=min(a,Real(c2Max));
+        a=max(a,Real(c2Min));
 
 
-        b=500*(f(xyz.getC2()/yb) - f(xyz.getC3()/zb));
-        b=min(b,c3Max);
-        b=max(b,c3Min);
+        b=Real(500)*(f(y/Real(yb)) - f(z/Real(zb)));
+        b=min(b,Real(c3Max));
+        b=max(b,Real(c3Min));
 
-        c1=l;
-        c2=a;
-        c3=b;
+        o1=l;
+        o2=a;
+        o3=b;
 
     }
 
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to LAB color space
+    * @param[in] r red in [0;255]
+    * @param[in] g green in [0;255]
+    * @param[in] b blue in [0;255]
+    */
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
+    }
+
 
 private:
-    double f(double x){
-        if(x>0.008856){
-            return pow(x,1./3.);
+    template<typename Real>
+    static Real f(Real x){
+        if(x>Real(0.008856)){
+            return pow(x,Real(1)/Real(3));
         }else{
-            return 7.787*x+16./116.;
+            return Real(7.787)*x+Real(16)/Real(116);
         }
     }
 
+    //reference white for default white (r=255, v=255 and b=255)
+    double xb;/*!< X of reference white*/
+    double yb;/*!< Y of reference white*/
+    double zb;/*!< Z of reference white*/
+
 };
 }
 
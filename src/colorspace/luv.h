@@ -37,70 +37,79 @@ public:
      */
     LUV(unsigned int red=255, unsigned int green=255, unsigned int blue=255){
         name="luv";
-        c1Min=0.;
-        c2Min=-131.95;
-        c3Min=-139.05;
-        c1Max=100.;
-        c2Max=220.8;
-        c3Max=121.47;
+        setRanges(0.,100.,
+                  -131.95,220.8,
+                  -139.05,121.47);
+        double xb,zb;
+        XYZ::compute(255.,255.,255.,xb,yb,zb);
+        utb=4*xb/(xb+15*yb+3*zb);
+        vtb=9*yb/(xb+15*yb+3*zb);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief createFromRGB cnvert from rgb to LUV color space
-    * @param[in] r red in [0;255]
-    * @param[in] g green in [0;255]
-    * @param[in] b blue in [0;255]
+    * @brief compute convert from rgb to LUV color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 l component
+    * @param[out] o2 u component
+    * @param[out] o3 v component
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
+    template<typename Real>
+    void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3) const{
         //convert from rgb to xyz color space
-        cs::XYZ xyz;
-
-        //reference white for default white (r=2555, v=255 and b=255)
-        double xb=xyz.getC1();
-        double yb=xyz.getC2();
-        double zb=xyz.getC3();
-
-        xyz.convertFromRGB(red,green,blue);
+        Real x,y,z;
+        XYZ::compute(red,green,blue,x,y,z);
 
-        double l,u,v;
-        double yr=xyz.getC2()/yb;
+        Real l,u,v;
+        Real yr=y/Real(yb);
 
-        if(yr>0.008856){
-            l=116*pow(yr,1./3.)-16;
+        if(yr>Real(0.008856)){
+            l=Real(116)*pow(yr,Real(1)/Real(3))-Real(16);
         }else{
-            l=903.3*yr;
+            l=Real(903.3)*yr;
         }
-        double ut=4*xyz.getC1()/(xyz.getC1()+15*xyz.getC2()+3*xyz.getC3());
-        double utb=4*xb/(xb+15*yb+3*zb);
-        u=13*l*(ut-utb);
-        u=min(u,c2Max);
-        u=max(u,c2Min);
+        Real ut=Real(4)*x/(x+Real(15)*y+Real(3)*z);
+        u=Real(13)*l*(ut-Real(utb));
+        u=min(u,Real(c2Max));
+        u=max(u,Real(c2Min));
 
 
-        double vt=9*xyz.getC2()/(xyz.getC1()+15*xyz.getC2()+3*xyz.getC3());
-        double vtb=9*yb/(xb+15*yb+3*zb);
-        v=13*l*(vt-vtb);
-        v=min(v,c3Max);
-        v=max(v,c3Min);
+        Real vt=Real(9)*y/(x+Real(15)*y+Real(3)*z);
+        v=Real(13)*l*(vt-Real(vtb));
+        v=min(v,Real(c3Max));
+        v=max(v,Real(c3Min));
 
-        c1=l;
-        c2=u;
-        c3=v;
+        o1=l;
+        o2=u;
+        o3=v;
 
     }
 
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to LUV color space
+    * @param[in] r red in [0;255]
+    * @param[in] g green in [0;255]
+    * @param[in] b blue in [0;255]
+    */
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
+    }
 
 
+private:
+    //reference white for default white (r=255, v=255 and b=255)
+    double yb;/*!< Y of reference white*/
+    double utb;/*!< u' of reference white*/
+    double vtb;/*!< v' of reference white*/
 
 };
 }
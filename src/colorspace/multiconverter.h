@@ -0,0 +1,86 @@
+#ifndef MULTICONVERTER_H
+#define MULTICONVERTER_H
+#include "tiledconverter.h"
+#include <cstdint>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The MultiTarget struct output planes of several color spaces
+ */
+template<typename Real>
+struct MultiTarget{
+    ColorspaceInterface* const* spaces;/*!< color spaces used for conversion*/
+    size_t spaceCount;/*!< number of color spaces*/
+    Real* const* c1;/*!< first channel plane of each color space*/
+    Real* const* c2;/*!< second channel plane of each color space*/
+    Real* const* c3;/*!< third channel plane of each color space*/
+};
+
+/**
+ * @brief forEachColorBlock run f on blocks of colors for all the target color
+ * spaces, one block after another
+ *
+ * A block is converted to every color space before the next block is read, so
+ * its input stays in cache for all the color spaces : the colors are read once
+ * from memory whatever the number of color spaces. Each color space keeps its
+ * own vectorized loop. Blocks are spread on all the cores when all the color
+ * spaces are known (see KnownColorspace), otherwise they are converted by the
+ * calling thread only.
+ *
+ * @param[in] target
+ * @param[in] count number of colors
+ * @param[in] f called as f(space,first,n,c1,c2,c3) with the planes of the space
+ * starting at first
+ */
+template<typename Real, typename F>
+void forEachColorBlock(const MultiTarget<Real>& target, size_t count, const F& f){
+    bool parallel=true;
+    for(size_t s=0;s<target.spaceCount;s++){
+        parallel=parallel && visitColorspace(*target.spaces[s],KnownColorspace());
+    }
+    //a block of 8 bits keys and its output for all the spaces fit in L2
+    const size_t blockSize=2048;
+    parallelForBlocks(0,count,parallel ? blockSize : count,[&](size_t first, size_t last){
+        for(size_t s=0;s<target.spaceCount;s++){
+            f(*target.spaces[s],first,last-first,target.c1[s]+first,target.c2[s]+first,target.c3[s]+first);
+        }
+    });
+}
+
+/**
+ * @brief convertPackedMulti convert packed 8 bits colors (0xRRGGBB) to several
+ * color spaces in one pass (see forEachColorBlock)
+ * @param[in] target color spaces and their output planes, count elements by plane
+ * @param[in] keys packed colors
+ * @param[in] count number of colors
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ */
+template<typename Real>
+void convertPackedMulti(const MultiTarget<Real>& target, const uint32_t* keys, size_t count, bool normalized){
+    forEachColorBlock(target,count,[&](ColorspaceInterface& space, size_t first, size_t n, Real* c1, Real* c2, Real* c3){
+        convertPacked(space,keys+first,n,c1,c2,c3,normalized);
+    });
+}
+
+/**
+ * @brief convertBufferMulti convert a buffer of rgb colors to several color
+ * spaces in one pass (see forEachColorBlock)
+ * @param[in] target color spaces and their output planes, count elements by plane
+ * @param[in] rgb interleaved red, green and blue values (depth given by T)
+ * @param[in] count number of colors
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ */
+template<typename T, typename Real>
+void convertBufferMulti(const MultiTarget<Real>& target, const T* rgb, size_t count, bool normalized){
+    validateBuffer(rgb,count);
+    forEachColorBlock(target,count,[&](ColorspaceInterface& space, size_t first, size_t n, Real* c1, Real* c2, Real* c3){
+        InterleavedInput<T,Real> in={rgb+3*first};
+        PlanarOutput<Real> o={c1,c2,c3};
+        convert<Real>(space,in,o,n,normalized);
+    });
+}
+
+}
+#endif // MULTICONVERTER_H
@@ -0,0 +1,485 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The Cancelled class exception thrown by the parallel loops of a
+ * cancelled task (see CancellationToken)
+ */
+class Cancelled : public runtime_error{
+public:
+    Cancelled(): runtime_error("cancelled"){
+    }
+};
+
+/**
+ * @brief The CancellationToken class flag shared by the copies of a token,
+ * set once to stop a task
+ *
+ * Tasks don't check it themselves : the parallel loops started under a
+ * CancellationScope stop handing out blocks once it is set, and throw Cancelled.
+ */
+class CancellationToken{
+public:
+    CancellationToken(): cancelled(make_shared<atomic<bool> >(false)){
+    }
+    void cancel(){
+        *cancelled=true;
+    }
+    bool isCancelled() const{
+        return *cancelled;
+    }
+    /**
+     * @brief throwIfCancelled
+     * @throw Cancelled if the token is cancelled
+     */
+    void throwIfCancelled() const{
+        if(isCancelled()){
+            throw Cancelled();
+        }
+    }
+    /**
+     * @brief current
+     * @return token of the innermost CancellationScope of the calling thread, NULL if none
+     */
+    static const CancellationToken*& current(){
+        static thread_local const CancellationToken* token=NULL;
+        return token;
+    }
+private:
+    shared_ptr<atomic<bool> > cancelled;/*!< shared by all the copies*/
+};
+
+/**
+ * @brief The CancellationScope class the parallel loops started by the calling
+ * thread during the life of the scope, and the loops they start on other
+ * threads, are stopped by a token
+ */
+class CancellationScope{
+public:
+    explicit CancellationScope(const CancellationToken& token): previous(CancellationToken::current()), token(token){
+        CancellationToken::current()=&this->token;
+    }
+    ~CancellationScope(){
+        CancellationToken::current()=previous;
+    }
+private:
+    CancellationScope(const CancellationScope&);
+    CancellationScope& operator=(const CancellationScope&);
+    const CancellationToken* previous;/*!< token of the enclosing scope*/
+    CancellationToken token;/*!< copy, shares its flag with the given token*/
+};
+
+/**
+ * @brief The ThreadPool class threads shared by all the parallel stages
+ *
+ * Each worker has its own queue : tasks submitted from a worker go to its queue
+ * and are run last in first out (still in cache), other tasks go to a shared
+ * queue. An idle worker takes from its queue, then from the shared queue, then
+ * steals the oldest task of another worker. Threads are created once, so
+ * nested parallel loops share them instead of creating threads of their own.
+ *
+ * The parallel loops use the current pool (see setCurrent), the threads calling
+ * them take part in the work.
+ */
+class ThreadPool{
+public:
+    /**
+     * @brief ThreadPool start the workers
+     * @param[in] threads number of threads running parallel loops, the calling
+     * thread included, 0 for the number of cores
+     * @param[in] pinned if true, worker i only runs on core i+1 (Linux only), the
+     * calling thread is not pinned
+     */
+    explicit ThreadPool(unsigned int threads=0, bool pinned=false): stopping(false), queued(0){
+        if(threads==0){
+            threads=thread::hardware_concurrency();
+        }
+        threadTotal=max(threads,1u);
+        queues.resize(threadTotal-1);
+        for(size_t w=0;w<queues.size();w++){
+            queues[w].reset(new WorkerQueue());
+        }
+        for(size_t w=0;w<queues.size();w++){
+            workers.push_back(thread(&ThreadPool::work,this,w));
+#ifdef __linux__
+            if(pinned){
+                //no worker runs on the first core, the calling thread itself is not pinned
+                cpu_set_t cores;
+                CPU_ZERO(&cores);
+                CPU_SET((w+1)%max(thread::hardware_concurrency(),1u),&cores);
+                pthread_setaffinity_np(workers.back().native_handle(),sizeof(cores),&cores);
+            }
+#else
+            (void)pinned;
+#endif
+        }
+    }
+
+    /**
+     * @brief ~ThreadPool stop the workers once their running task ends, queued
+     * tasks are dropped
+     */
+    ~ThreadPool(){
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping=true;
+        }
+        wakeUp.notify_all();
+        for(size_t w=0;w<workers.size();w++){
+            workers[w].join();
+        }
+        ThreadPool* self=this;
+        currentPool().compare_exchange_strong(self,NULL);
+    }
+
+    /**
+     * @brief size
+     * @return number of threads running a parallel loop, the calling thread included
+     */
+    unsigned int size() const{
+        return threadTotal;
+    }
+
+    /**
+     * @brief submit run a task on a worker, exceptions thrown by the task are
+     * ignored (see packaged_task to get them)
+     * @param[in] task
+     */
+    void submit(const function<void()>& task){
+        if(workers.empty()){
+            runTask(task);
+            return;
+        }
+        if(workerId().pool==this){
+            WorkerQueue& queue=*queues[workerId().index];
+            lock_guard<mutex> lock(queue.lock);
+            queue.tasks.push_back(task);
+        }else{
+            lock_guard<mutex> lock(shared.lock);
+            shared.tasks.push_back(task);
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            queued++;
+        }
+        wakeUp.notify_one();
+    }
+
+    /**
+     * @brief current
+     * @return pool used by the parallel loops, one thread by core if none was set
+     */
+    static ThreadPool& current(){
+        ThreadPool* pool=currentPool();
+        if(pool!=NULL){
+            return *pool;
+        }
+        static ThreadPool defaultPool;
+        return defaultPool;
+    }
+
+    /**
+     * @brief setCurrent choose the pool used by the parallel loops, it must stay
+     * alive until replaced
+     * @param[in] pool NULL for the default pool
+     */
+    static void setCurrent(ThreadPool* pool){
+        currentPool()=pool;
+    }
+
+private:
+    /**
+     * @brief The WorkerQueue struct tasks of a worker, or the shared tasks
+     */
+    struct WorkerQueue{
+        mutex lock;/*!< protects tasks*/
+        deque<function<void()> > tasks;/*!< pushed and popped at the back by the owner, stolen at the front*/
+    };
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    static atomic<ThreadPool*>& currentPool(){
+        static atomic<ThreadPool*> pool(NULL);
+        return pool;
+    }
+
+    /**
+     * @brief The WorkerId struct pool and index of the calling thread, if it is a worker
+     */
+    struct WorkerId{
+        const ThreadPool* pool;/*!< NULL if the thread is not a worker*/
+        size_t index;/*!< index of the worker in its pool*/
+    };
+
+    static WorkerId& workerId(){
+        static thread_local WorkerId id={NULL,0};
+        return id;
+    }
+
+    static void runTask(const function<void()>& task){
+        try{
+            task();
+        }catch(...){
+        }
+    }
+
+    /**
+     * @brief take remove a task : the newest of the worker's queue, else the
+     * oldest shared one, else the oldest of another worker
+     * @param[in] w worker index
+     * @param[out] task
+     * @return false if there is no task
+     */
+    bool take(size_t w, function<void()>& task){
+        {
+            lock_guard<mutex> lock(queues[w]->lock);
+            if(!queues[w]->tasks.empty()){
+                task.swap(queues[w]->tasks.back());
+                queues[w]->tasks.pop_back();
+                return true;
+            }
+        }
+        {
+            lock_guard<mutex> lock(shared.lock);
+            if(!shared.tasks.empty()){
+                task.swap(shared.tasks.front());
+                shared.tasks.pop_front();
+                return true;
+            }
+        }
+        for(size_t i=1;i<queues.size();i++){
+            WorkerQueue& victim=*queues[(w+i)%queues.size()];
+            lock_guard<mutex> lock(victim.lock);
+            if(!victim.tasks.empty()){
+                task.swap(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t w){
+        workerId().pool=this;
+        workerId().index=w;
+        function<void()> task;
+        while(true){
+            {
+                unique_lock<mutex> lock(sleepMutex);
+                wakeUp.wait(lock,[&](){ return stopping || queued>0; });
+                if(stopping){
+                    return;
+                }
+                queued--;
+            }
+            //the task counted may have been taken by another worker : keep looking
+            while(!take(w,task)){
+                this_thread::yield();
+                lock_guard<mutex> lock(sleepMutex);
+                if(stopping){
+                    return;
+                }
+            }
+            runTask(task);
+            task=function<void()>();
+        }
+    }
+
+    unsigned int threadTotal;/*!< workers and the calling thread*/
+    vector<unique_ptr<WorkerQueue> > queues;/*!< a queue by worker*/
+    WorkerQueue shared;/*!< tasks submitted by other threads*/
+    vector<thread> workers;/*!< threadTotal-1 threads*/
+    mutex sleepMutex;/*!< protects stopping and queued*/
+    condition_variable wakeUp;/*!< signaled when a task is queued or the pool stops*/
+    bool stopping;/*!< true once the pool is destroyed*/
+    size_t queued;/*!< number of queued tasks not yet claimed by a worker*/
+};
+
+/**
+ * @brief threadCount
+ * @return number of threads used by parallel loops (see ThreadPool::current)
+ */
+inline unsigned int threadCount(){
+    return ThreadPool::current().size();
+}
+
+/**
+ * @brief parallelForBlocks run f on blocks of [begin;end[ with the threads of
+ * the current pool
+ *
+ * Blocks are given to threads on demand, so uneven blocks are balanced. The
+ * calling thread takes blocks too : it ends the loop alone if the workers are
+ * busy, so loops can be nested. The first exception thrown by f is rethrown
+ * once all threads are done. Under a cancelled CancellationScope, the remaining
+ * blocks are skipped and Cancelled is thrown.
+ *
+ * @param[in] begin first index
+ * @param[in] end last index (excluded)
+ * @param[in] blockSize number of indexes by block
+ * @param[in] f called as f(blockBegin,blockEnd)
+ */
+template<typename F>
+void parallelForBlocks(size_t begin, size_t end, size_t blockSize, const F& f){
+    if(end<=begin){
+        return;
+    }
+    const CancellationToken* token=CancellationToken::current();
+    if(token!=NULL){
+        token->throwIfCancelled();
+    }
+    blockSize=max(blockSize,size_t(1));
+
+    //shared with the helpers, which may start after the loop returned
+    struct Loop{
+        size_t blocks;
+        atomic<size_t> next;
+        atomic<size_t> active;
+        exception_ptr error;
+        mutex lock;
+        condition_variable done;
+        CancellationToken token;
+        bool cancellable;
+    };
+    shared_ptr<Loop> loop=make_shared<Loop>();
+    loop->blocks=(end-begin+blockSize-1)/blockSize;
+    loop->next=0;
+    loop->active=0;
+    loop->cancellable=token!=NULL;
+    if(token!=NULL){
+        loop->token=*token;
+    }
+    //f is only called while the caller waits
+    const F* body=&f;
+    auto run=[loop,body,begin,end,blockSize](){
+        Loop& l=*loop;
+        CancellationToken* scopeToken= l.cancellable ? &l.token : NULL;
+        for(size_t b=l.next++;b<l.blocks;b=l.next++){
+            if(scopeToken!=NULL && scopeToken->isCancelled()){
+                l.next=l.blocks;
+                break;
+            }
+            try{
+                size_t first=begin+b*blockSize;
+                (*body)(first,min(end,first+blockSize));
+            }catch(...){
+                lock_guard<mutex> lock(l.lock);
+                if(!l.error){
+                    l.error=current_exception();
+                }
+            }
+        }
+    };
+    auto helper=[loop,run](){
+        Loop& l=*loop;
+        l.active++;
+        if(l.next>=l.blocks){
+            //loop already over
+            lock_guard<mutex> lock(l.lock);
+            l.active--;
+            l.done.notify_all();
+            return;
+        }
+        if(l.cancellable){
+            CancellationScope scope(l.token);
+            run();
+        }else{
+            run();
+        }
+        lock_guard<mutex> lock(l.lock);
+        l.active--;
+        l.done.notify_all();
+    };
+
+    ThreadPool& pool=ThreadPool::current();
+    size_t helpers=min<size_t>(pool.size(),loop->blocks)-1;
+    for(size_t h=0;h<helpers;h++){
+        pool.submit(helper);
+    }
+    run();
+    {
+        //every block is taken : wait for the helpers still running one
+        unique_lock<mutex> lock(loop->lock);
+        loop->done.wait(lock,[&](){ return loop->active==0; });
+    }
+    if(loop->error){
+        rethrow_exception(loop->error);
+    }
+    if(token!=NULL){
+        token->throwIfCancelled();
+    }
+}
+
+/**
+ * @brief parallelFor run f on each index of [begin;end[ with the threads of the
+ * current pool (see parallelForBlocks)
+ * @param[in] begin first index
+ * @param[in] end last index (excluded)
+ * @param[in] f called as f(index)
+ */
+template<typename F>
+void parallelFor(size_t begin, size_t end, const F& f){
+    parallelForBlocks(begin,end,1,[&](size_t first, size_t last){
+        for(size_t i=first;i<last;i++){
+            f(i);
+        }
+    });
+}
+
+/**
+ * @brief parallelReduce reduce [begin;end[ by blocks with the threads of the
+ * current pool, then combine the results in the order of the blocks
+ *
+ * Blocks have a fixed size, so the result doesn't depend on the number of
+ * threads nor on which one ends first, even if combine is not associative
+ * (floating point sums). One result by block is kept until the end.
+ *
+ * @param[in] begin first index
+ * @param[in] end last index (excluded)
+ * @param[in] blockSize number of indices by block, end-begin for a single
+ * block run by the calling thread
+ * @param[in] init first value given to combine, returned for an empty range
+ * @param[in] map called as map(first,last), returns the result of a block
+ * @param[in] combine called as combine(result,blockResult), returns their
+ * merge, result is moved in
+ * @return init combined with the result of each block, in order
+ */
+template<typename T, typename Map, typename Combine>
+T parallelReduce(size_t begin, size_t end, size_t blockSize, T init, const Map& map, const Combine& combine){
+    if(end<=begin){
+        return init;
+    }
+    blockSize=max(blockSize,size_t(1));
+    vector<T> results((end-begin+blockSize-1)/blockSize);
+    parallelFor(0,results.size(),[&](size_t block){
+        size_t first=begin+block*blockSize;
+        results[block]=map(first,min(end,first+blockSize));
+    });
+    for(size_t block=0;block<results.size();block++){
+        init=combine(move(init),results[block]);
+    }
+    return init;
+}
+
+}
+#endif // PARALLEL_H
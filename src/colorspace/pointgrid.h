@@ -0,0 +1,247 @@
+#ifndef POINTGRID_H
+#define POINTGRID_H
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The PointGrid class uniform grid over points of [0;1]^3, to find the
+ * point nearest to a ray (mouse picking)
+ *
+ * Points are sorted by cell (counting sort) : a cell is a range of indexes.
+ * A ray only visits the cells it crosses (3D DDA) and their neighbours, so a
+ * query reads a few hundred points whatever the number of points.
+ */
+class PointGrid{
+public:
+    PointGrid(): x(NULL), y(NULL), z(NULL), resolution(0), query(0){
+    }
+
+    /**
+     * @brief build sort points by cell
+     *
+     * Points out of [0;1]^3 are clamped in the border cells, NaN points are left out.
+     *
+     * @param[in] x first coordinate of each point, must outlive the grid
+     * @param[in] y second coordinate of each point, must outlive the grid
+     * @param[in] z third coordinate of each point, must outlive the grid
+     * @param[in] count number of points
+     * @param[in] resolution number of cells along each axis
+     */
+    void build(const float* x, const float* y, const float* z, size_t count, int resolution=64){
+        this->x=x;
+        this->y=y;
+        this->z=z;
+        this->resolution=resolution;
+        size_t cellCount=size_t(resolution)*resolution*resolution;
+        cellStart.assign(cellCount+1,0);
+        stamps.assign(cellCount,0);
+        query=0;
+
+        vector<uint32_t> cells(count);
+        for(size_t i=0;i<count;i++){
+            if(x[i]!=x[i] || y[i]!=y[i] || z[i]!=z[i]){
+                cells[i]=uint32_t(cellCount);
+                continue;
+            }
+            cells[i]=uint32_t(cellIndex(cellCoordinate(x[i]),cellCoordinate(y[i]),cellCoordinate(z[i])));
+            cellStart[cells[i]+1]++;
+        }
+        for(size_t c=0;c<cellCount;c++){
+            cellStart[c+1]+=cellStart[c];
+        }
+        indexes.resize(cellStart[cellCount]);
+        vector<uint32_t> next(cellStart.begin(),cellStart.end()-1);
+        for(size_t i=0;i<count;i++){
+            if(cells[i]<cellCount){
+                indexes[next[cells[i]]++]=uint32_t(i);
+            }
+        }
+    }
+
+    /**
+     * @brief empty
+     * @return true if build has not been called or there was no valid point
+     */
+    bool empty() const{
+        return indexes.empty();
+    }
+
+    /**
+     * @brief pick find the point nearest to the origin of a ray, among the points
+     * closer to the ray than radius
+     *
+     * Not thread-safe : cells are stamped to visit each of them once.
+     *
+     * @param[in] origin origin of the ray (x, y, z)
+     * @param[in] direction direction of the ray, not null
+     * @param[in] radius maximal distance between the ray and the point, at most
+     * the size of a cell (1/resolution)
+     * @return index of the point, -1 if there is none
+     */
+    long pick(const float origin[3], const float direction[3], float radius){
+        return pick(origin,direction,radius,AcceptAll());
+    }
+
+    /**
+     * @brief pick find the point nearest to the origin of a ray, among the points
+     * closer to the ray than radius and accepted by a filter (hidden points are
+     * not picked)
+     * @param[in] origin origin of the ray (x, y, z)
+     * @param[in] direction direction of the ray, not null
+     * @param[in] radius maximal distance between the ray and the point, at most
+     * the size of a cell (1/resolution)
+     * @param[in] accept called as accept(index), returns false to skip the point
+     * @return index of the point, -1 if there is none
+     */
+    template<typename Accept>
+    long pick(const float origin[3], const float direction[3], float radius, const Accept& accept){
+        if(empty()){
+            return -1;
+        }
+        double o[3]={origin[0],origin[1],origin[2]};
+        double length=sqrt(double(direction[0])*direction[0]+double(direction[1])*direction[1]+double(direction[2])*direction[2]);
+        double d[3]={direction[0]/length,direction[1]/length,direction[2]/length};
+
+        //part of the ray inside the cube, grown by radius
+        double tEnter=0;
+        double tExit=1e30;
+        for(int a=0;a<3;a++){
+            double low=-radius;
+            double high=1.+radius;
+            if(d[a]==0){
+                if(o[a]<low || o[a]>high){
+                    return -1;
+                }
+                continue;
+            }
+            double t1=(low-o[a])/d[a];
+            double t2=(high-o[a])/d[a];
+            tEnter=max(tEnter,min(t1,t2));
+            tExit=min(tExit,max(t1,t2));
+        }
+        if(tEnter>tExit){
+            return -1;
+        }
+
+        //3D DDA from the entry point
+        double cellSize=1./resolution;
+        int cell[3];
+        int step[3];
+        double tNext[3];
+        double tDelta[3];
+        for(int a=0;a<3;a++){
+            double p=o[a]+tEnter*d[a];
+            cell[a]=cellCoordinate(float(p));
+            step[a]= d[a]>0 ? 1 : -1;
+            if(d[a]==0){
+                tNext[a]=1e30;
+                tDelta[a]=1e30;
+            }else{
+                double boundary=(cell[a]+(d[a]>0 ? 1 : 0))*cellSize;
+                tNext[a]=tEnter+(boundary-p)/d[a];
+                tDelta[a]=cellSize/fabs(d[a]);
+            }
+        }
+
+        query++;
+        if(query==0){
+            //stamps wrapped around
+            fill(stamps.begin(),stamps.end(),0);
+            query=1;
+        }
+        long best=-1;
+        double bestT=1e30;
+        double r2=double(radius)*radius;
+        double t=tEnter;
+        //a point of a later cell can't be in front of the best one by more than this
+        double margin=2.*sqrt(3.)*cellSize;
+        while(t<=tExit && t<=bestT+margin){
+            for(int i=-1;i<=1;i++){
+                for(int j=-1;j<=1;j++){
+                    for(int k=-1;k<=1;k++){
+                        testCell(cell[0]+i,cell[1]+j,cell[2]+k,o,d,r2,accept,best,bestT);
+                    }
+                }
+            }
+            int a= tNext[0]<tNext[1] ? (tNext[0]<tNext[2] ? 0 : 2) : (tNext[1]<tNext[2] ? 1 : 2);
+            t=tNext[a];
+            tNext[a]+=tDelta[a];
+            cell[a]+=step[a];
+            if(cell[a]<-1 || cell[a]>resolution){
+                break;
+            }
+        }
+        return best;
+    }
+
+private:
+    /**
+     * @brief The AcceptAll struct filter accepting every point
+     */
+    struct AcceptAll{
+        bool operator()(uint32_t) const{
+            return true;
+        }
+    };
+
+    /**
+     * @brief cellCoordinate
+     * @param[in] v coordinate in [0;1]
+     * @return index of the cell along an axis, clamped to the grid
+     */
+    int cellCoordinate(float v) const{
+        int c=int(v*resolution);
+        return min(max(c,0),resolution-1);
+    }
+
+    size_t cellIndex(int i, int j, int k) const{
+        return (size_t(i)*resolution+j)*resolution+k;
+    }
+
+    /**
+     * @brief testCell test the points of a cell not visited by the current query
+     */
+    template<typename Accept>
+    void testCell(int i, int j, int k, const double o[3], const double d[3], double r2, const Accept& accept,
+                  long& best, double& bestT){
+        if(i<0 || j<0 || k<0 || i>=resolution || j>=resolution || k>=resolution){
+            return;
+        }
+        size_t c=cellIndex(i,j,k);
+        if(stamps[c]==query){
+            return;
+        }
+        stamps[c]=query;
+        for(uint32_t n=cellStart[c];n<cellStart[c+1];n++){
+            uint32_t p=indexes[n];
+            double w[3]={x[p]-o[0],y[p]-o[1],z[p]-o[2]};
+            double t=w[0]*d[0]+w[1]*d[1]+w[2]*d[2];
+            if(t<0 || t>=bestT){
+                continue;
+            }
+            double e[3]={w[0]-t*d[0],w[1]-t*d[1],w[2]-t*d[2]};
+            if(e[0]*e[0]+e[1]*e[1]+e[2]*e[2]<=r2 && accept(p)){
+                best=long(p);
+                bestT=t;
+            }
+        }
+    }
+
+    const float* x;/*!< first coordinate of each point*/
+    const float* y;/*!< second coordinate of each point*/
+    const float* z;/*!< third coordinate of each point*/
+    int resolution;/*!< number of cells along each axis*/
+    vector<uint32_t> cellStart;/*!< first index of each cell in indexes, and the end*/
+    vector<uint32_t> indexes;/*!< points sorted by cell*/
+    vector<uint32_t> stamps;/*!< last query visiting each cell*/
+    uint32_t query;/*!< number of the current query*/
+};
+
+}
+#endif // POINTGRID_H
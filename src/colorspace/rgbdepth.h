@@ -0,0 +1,95 @@
+#ifndef RGBDEPTH_H
+#define RGBDEPTH_H
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+namespace cs{
+/**
+ * @brief The RGBDepth traits describe an input depth of the conversion engine
+ *
+ * Color spaces formulas are written for red, green and blue in [0;255].
+ * Each depth gives the factor used to bring its values in this range and
+ * tells if its values must be validated before conversion.
+ *
+ * Supported depths :
+ *  + unsigned char : [0;255], every value is valid
+ *  + unsigned short : [0;65535], every value is valid
+ *  + float : [0;1], values must be checked (negative, greater than 1, NaN...)
+ */
+template<typename T>
+struct RGBDepth;
+
+template<>
+struct RGBDepth<unsigned char>{
+    static const bool needsValidation=false;/*!< the whole domain is valid */
+    /**
+     * @brief scale
+     * @return factor to bring a value in [0;255]
+     */
+    static double scale(){
+        return 1.;
+    }
+    static bool isValid(unsigned char){
+        return true;
+    }
+};
+
+template<>
+struct RGBDepth<unsigned short>{
+    static const bool needsValidation=false;/*!< the whole domain is valid */
+    /**
+     * @brief scale
+     * @return factor to bring a value in [0;255]
+     */
+    static double scale(){
+        return 255./65535.;
+    }
+    static bool isValid(unsigned short){
+        return true;
+    }
+};
+
+template<>
+struct RGBDepth<float>{
+    static const bool needsValidation=true;/*!< values out of [0;1] must be rejected */
+    /**
+     * @brief scale
+     * @return factor to bring a value in [0;255]
+     */
+    static double scale(){
+        return 255.;
+    }
+    static bool isValid(float v){
+        //false for NaN too
+        return v>=0.f && v<=1.f;
+    }
+};
+
+/**
+ * @brief validateBuffer test validity of all the values of an rgb buffer
+ *
+ * Validation is done once for the whole buffer, and is removed at compile time
+ * for depths where every value is valid.
+ *
+ * @param[in] rgb interleaved red, green and blue values
+ * @param[in] count number of colors in the buffer
+ */
+template<typename T>
+void validateBuffer(const T* rgb, size_t count){
+    if(!RGBDepth<T>::needsValidation){
+        return;
+    }
+    //counting instead of breaking on first error keeps the loop vectorizable
+    size_t invalid=0;
+    for(size_t i=0;i<3*count;i++){
+        invalid+=RGBDepth<T>::isValid(rgb[i]) ? 0 : 1;
+    }
+    if(invalid>0){
+        throw runtime_error(to_string(invalid)+" rgb values out of range");
+    }
+}
+
+}
+#endif // RGBDEPTH_H
@@ -0,0 +1,93 @@
+#ifndef SPARSECOLORCOUNTER_H
+#define SPARSECOLORCOUNTER_H
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+namespace cs{
+/**
+ * @brief The SparseColorCounter class count occurences of 16 bits rgb colors
+ *
+ * 16 bits per channel colors live in a 2^48 domain, too big for a bitset or a
+ * dense histogram, so colors are hashed. Each color is packed in a 64 bits key :
+ * (red<<32) | (green<<16) | blue
+ */
+class SparseColorCounter{
+public:
+    /**
+     * @brief addPixels count colors of a pixels buffer
+     *
+     * Channels after the third one (alpha) are ignored. With one or two channels
+     * the first one is used as a gray level.
+     *
+     * @param[in] data interleaved pixels values
+     * @param[in] pixelCount number of pixels in the buffer
+     * @param[in] channels number of channels per pixel
+     */
+    void addPixels(const unsigned short* data, size_t pixelCount, size_t channels){
+        if(counts.empty()){
+            //most images have far less colors than pixels
+            counts.reserve(pixelCount/4+1);
+        }
+        uint64_t lastKey=0;
+        unsigned int* lastCount=NULL;
+        for(size_t i=0;i<pixelCount;i++){
+            const unsigned short* p=data+i*channels;
+            uint64_t key= channels>=3 ? pack(p[0],p[1],p[2]) : pack(p[0],p[0],p[0]);
+            //neighbour pixels often share the same color : skip the hash lookup
+            if(lastCount!=NULL && key==lastKey){
+                (*lastCount)++;
+                continue;
+            }
+            lastCount=&counts[key];
+            (*lastCount)++;
+            lastKey=key;
+        }
+    }
+
+    /**
+     * @brief size
+     * @return number of distinct colors
+     */
+    size_t size() const{
+        return counts.size();
+    }
+
+    /**
+     * @brief clear remove all the counted colors
+     */
+    void clear(){
+        counts.clear();
+    }
+
+    /**
+     * @brief getColors get distinct colors and their number of occurences
+     * @param[out] rgb interleaved red, green and blue values, 3*size() elements
+     * @param[out] occurences number of pixels of each color, size() elements
+     */
+    void getColors(vector<unsigned short>& rgb, vector<unsigned int>& occurences) const{
+        rgb.resize(3*counts.size());
+        occurences.resize(counts.size());
+        size_t i=0;
+        for(auto it=counts.begin();it!=counts.end();it++,i++){
+            rgb[3*i]=(unsigned short)(it->first>>32);
+            rgb[3*i+1]=(unsigned short)(it->first>>16);
+            rgb[3*i+2]=(unsigned short)(it->first);
+            occurences[i]=it->second;
+        }
+    }
+
+    /**
+     * @brief pack pack a 16 bits rgb color in a 64 bits key
+     */
+    static uint64_t pack(unsigned short red, unsigned short green, unsigned short blue){
+        return (uint64_t(red)<<32) | (uint64_t(green)<<16) | uint64_t(blue);
+    }
+
+private:
+    unordered_map<uint64_t,unsigned int> counts;/*!< number of pixels by packed color*/
+};
+}
+#endif // SPARSECOLORCOUNTER_H
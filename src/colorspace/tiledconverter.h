@@ -0,0 +1,85 @@
+#ifndef TILEDCONVERTER_H
+#define TILEDCONVERTER_H
+#include "batchconverter.h"
+#include "parallel.h"
+#include <vector>
+using namespace std;
+
+namespace cs{
+
+/**
+ * @brief The KnownColorspace struct visitor doing nothing, to test if a color
+ * space has a batch kernel (see visitColorspace)
+ */
+struct KnownColorspace{
+    template<typename Space>
+    void operator()(const Space&) const{
+    }
+};
+
+/**
+ * @brief forEachTile fill the tiles of an image with all the cores and hand them
+ * to a sink in image order
+ *
+ * A batch of one tile by thread is filled in parallel, then the tiles are handed
+ * to the sink. Memory used is one batch of tiles whatever the image size, so the
+ * sink can stream the result to a file.
+ *
+ * @param[in] pixelCount number of pixels of the image
+ * @param[in] tilePixels number of pixels by tile
+ * @param[in] parallel if false, tiles are filled by the calling thread only
+ * @param[in] fill called as fill(firstPixel,count,c1,c2,c3) to write the channels of a tile
+ * @param[in] sink called as sink(firstPixel,count,c1,c2,c3), returns false to stop
+ * @return false if the sink stopped
+ */
+template<typename Fill, typename Sink>
+bool forEachTile(size_t pixelCount, size_t tilePixels, bool parallel, const Fill& fill, Sink& sink){
+    size_t tilesByBatch=parallel ? threadCount() : 1;
+    vector<float> planes(tilesByBatch*tilePixels*3);
+    for(size_t batch=0;batch<pixelCount;batch+=tilesByBatch*tilePixels){
+        size_t batchEnd=min(pixelCount,batch+tilesByBatch*tilePixels);
+        size_t tiles=(batchEnd-batch+tilePixels-1)/tilePixels;
+        parallelFor(0,tiles,[&](size_t t){
+            size_t first=batch+t*tilePixels;
+            size_t count=min(batchEnd,first+tilePixels)-first;
+            float* c1=&planes[3*t*tilePixels];
+            fill(first,count,c1,c1+tilePixels,c1+2*tilePixels);
+        });
+        for(size_t t=0;t<tiles;t++){
+            size_t first=batch+t*tilePixels;
+            size_t count=min(batchEnd,first+tilePixels)-first;
+            const float* c1=&planes[3*t*tilePixels];
+            if(!sink(first,count,c1,c1+tilePixels,c1+2*tilePixels)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief convertTiled convert every pixel of an image, tile by tile, with all the cores
+ *
+ * See forEachTile. Known color spaces are converted with their const kernels
+ * and can be shared by threads. Other color spaces are converted by the
+ * calling thread only.
+ *
+ * @param[in,out] space color space used for conversion
+ * @param[in] rgb interleaved red, green and blue values (depth given by T)
+ * @param[in] pixelCount number of pixels of the image
+ * @param[in] normalized if true, output normalized ([0;1]) values
+ * @param[in] sink called as sink(firstPixel,count,c1,c2,c3), returns false to stop
+ * @param[in] tilePixels number of pixels by tile
+ * @return false if the sink stopped the conversion
+ */
+template<typename T, typename Sink>
+bool convertTiled(ColorspaceInterface& space, const T* rgb, size_t pixelCount, bool normalized,
+                  Sink& sink, size_t tilePixels=size_t(1)<<18){
+    auto fill=[&](size_t first, size_t count, float* c1, float* c2, float* c3){
+        convertBufferToPlanes(space,rgb+3*first,count,c1,c2,c3,normalized);
+    };
+    return forEachTile(pixelCount,tilePixels,visitColorspace(space,KnownColorspace()),fill,sink);
+}
+
+}
+#endif // TILEDCONVERTER_H
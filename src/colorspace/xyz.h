@@ -34,34 +34,44 @@ public:
      */
     XYZ(unsigned int red=255, unsigned int green=255, unsigned int blue=255){
         name="xyz";
-        c1Min=0.;
-        c2Min=0.;
-        c3Min=0.;
-        c1Max=250.16;
-        c2Max=255.;
-        c3Max=301.41;
+        setRanges(0.,250.16,
+                  0.,255.,
+                  0.,301.41);
 
         convertFromRGB(red,green,blue);
 
     }
 
     /**
-    * @brief convertFromRGB cnvert from rgb to XYZ color space
+    * @brief compute convert from rgb to XYZ color space
+    *
+    * Templated on the floating point type so batch conversion can run in
+    * float or double precision (see batchconverter.h)
+    *
+    * @param[in] red red in [0;255]
+    * @param[in] green green in [0;255]
+    * @param[in] blue blue in [0;255]
+    * @param[out] o1 X component
+    * @param[out] o2 Y component
+    * @param[out] o3 Z component
+    */
+    template<typename Real>
+    static void compute(Real red, Real green, Real blue, Real& o1, Real& o2, Real& o3){
+        //convert from rgb to xyz color space
+        o1=red*Real(0.607)+green*Real(0.174)+blue*Real(0.200);
+        o2=red*Real(0.299)+green*Real(0.587)+blue*Real(0.114);
+        o3=green*Real(0.066)+blue*Real(1.116);
+    }
+
+protected:
+    /**
+    * @brief computeFromRGB cnvert from rgb to XYZ color space
     * @param[in] r red in [0;255]
     * @param[in] g green in [0;255]
     * @param[in] b blue in [0;255]
     */
-    virtual void convertFromRGB(unsigned int red, unsigned int green, unsigned int blue){
-        checkRGB(red,green,blue);
-        //store rgb color
-        r=red;
-        g=green;
-        b=blue;
-
-        //convert from rgb to xyz color space
-        c1=red*0.607+green*0.174+blue*0.200;
-        c2=red*0.299+green*0.587+blue*0.114;
-        c3=green*0.066+blue*1.116;
+    virtual void computeFromRGB(double red, double green, double blue){
+        compute(red,green,blue,c1,c2,c3);
     }
 
 
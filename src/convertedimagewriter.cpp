@@ -0,0 +1,125 @@
+#include "convertedimagewriter.h"
+
+#include <algorithm>
+#include <vector>
+
+ConvertedImageWriter::ConvertedImageWriter(): format(TIFF_16), remaining(0){
+}
+
+ConvertedImageWriter::Format ConvertedImageWriter::formatFromPath(string path){
+    size_t dot=path.find_last_of('.');
+    string ext= dot==string::npos ? "" : path.substr(dot+1);
+    transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+    return ext=="tif" || ext=="tiff" ? TIFF_16 : FLOAT_RAW;
+}
+
+bool ConvertedImageWriter::open(string path, Format format, size_t width, size_t height, const string names[3]){
+    close();
+    this->format=format;
+    remaining=width*height;
+    if(format==TIFF_16){
+        //classic tiff offsets are 32 bits
+        if(uint64_t(width)*height*6+512>0xffffffffULL){
+            return false;
+        }
+        files[0].open(path.c_str(),ios::binary);
+        if(!files[0]){
+            return false;
+        }
+        writeTiffHeader(width,height);
+        return bool(files[0]);
+    }
+
+    size_t dot=path.find_last_of('.');
+    size_t slash=path.find_last_of("/\\");
+    string base= dot!=string::npos && (slash==string::npos || dot>slash) ? path.substr(0,dot) : path;
+    for(int c=0;c<3;c++){
+        files[c].open((base+"_"+names[c]+".raw").c_str(),ios::binary);
+        if(!files[c]){
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConvertedImageWriter::writeTiffEntry(uint16_t tag, uint16_t type, uint32_t count, uint32_t value){
+    files[0].write(reinterpret_cast<const char*>(&tag),2);
+    files[0].write(reinterpret_cast<const char*>(&type),2);
+    files[0].write(reinterpret_cast<const char*>(&count),4);
+    if(type==3 && count==1){
+        //a single SHORT is left justified in the value field
+        uint16_t shortValue[2]={uint16_t(value),0};
+        files[0].write(reinterpret_cast<const char*>(shortValue),4);
+    }else{
+        files[0].write(reinterpret_cast<const char*>(&value),4);
+    }
+}
+
+void ConvertedImageWriter::writeTiffHeader(size_t width, size_t height){
+    //native byte order : "II" (little endian) or "MM" (big endian)
+    const uint16_t one=1;
+    const char* order= *reinterpret_cast<const char*>(&one)==1 ? "II" : "MM";
+    files[0].write(order,2);
+    const uint16_t magic=42;
+    files[0].write(reinterpret_cast<const char*>(&magic),2);
+    const uint32_t directoryOffset=8;
+    files[0].write(reinterpret_cast<const char*>(&directoryOffset),4);
+
+    //directory, then bits per sample, then pixels in a single strip
+    const uint16_t entries=10;
+    const uint32_t bitsOffset=directoryOffset+2+entries*12+4;
+    const uint32_t pixelsOffset=bitsOffset+6;
+    files[0].write(reinterpret_cast<const char*>(&entries),2);
+    writeTiffEntry(256,4,1,uint32_t(width));//ImageWidth
+    writeTiffEntry(257,4,1,uint32_t(height));//ImageLength
+    writeTiffEntry(258,3,3,bitsOffset);//BitsPerSample
+    writeTiffEntry(259,3,1,1);//Compression : none
+    writeTiffEntry(262,3,1,2);//PhotometricInterpretation : RGB
+    writeTiffEntry(273,4,1,pixelsOffset);//StripOffsets
+    writeTiffEntry(277,3,1,3);//SamplesPerPixel
+    writeTiffEntry(278,4,1,uint32_t(height));//RowsPerStrip
+    writeTiffEntry(279,4,1,uint32_t(width*height*6));//StripByteCounts
+    writeTiffEntry(284,3,1,1);//PlanarConfiguration : interleaved
+    const uint32_t nextDirectory=0;
+    files[0].write(reinterpret_cast<const char*>(&nextDirectory),4);
+    const uint16_t bits[3]={16,16,16};
+    files[0].write(reinterpret_cast<const char*>(bits),6);
+}
+
+bool ConvertedImageWriter::write(const float* c1, const float* c2, const float* c3, size_t count){
+    if(count>remaining){
+        return false;
+    }
+    remaining-=count;
+    if(format==FLOAT_RAW){
+        files[0].write(reinterpret_cast<const char*>(c1),count*sizeof(float));
+        files[1].write(reinterpret_cast<const char*>(c2),count*sizeof(float));
+        files[2].write(reinterpret_cast<const char*>(c3),count*sizeof(float));
+        return files[0] && files[1] && files[2];
+    }
+
+    vector<uint16_t> samples(3*count);
+    const float* planes[3]={c1,c2,c3};
+    for(size_t i=0;i<count;i++){
+        for(int c=0;c<3;c++){
+            float v=min(max(planes[c][i],0.f),1.f);
+            samples[3*i+c]=uint16_t(v*65535.f+0.5f);
+        }
+    }
+    files[0].write(reinterpret_cast<const char*>(samples.data()),samples.size()*sizeof(uint16_t));
+    return bool(files[0]);
+}
+
+bool ConvertedImageWriter::close(){
+    bool ok=remaining==0;
+    for(int c=0;c<3;c++){
+        if(files[c].is_open()){
+            files[c].close();
+            ok=ok && bool(files[c]);
+        }
+        files[c].clear();
+    }
+    remaining=0;
+    return ok;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+using namespace std;
+
+/**
+ * @brief The ConvertedImageWriter class stream the converted channels of an image to files
+ *
+ * Formats :
+ *  + TIFF_16 : one uncompressed 16 bits tiff, 3 samples per pixel. Channels must
+ *    be normalized ([0;1]), they are stored as [0;65535].
+ *  + FLOAT_RAW : one file of native 32 bits floats by channel, no header,
+ *    named <path without extension>_<channel name>.raw. Channels are stored as is,
+ *    so raw (not normalized) values can be written.
+ *
+ * Pixels are written in image order, a group of pixels at a time, so the whole
+ * converted image never has to be in memory.
+ */
+class ConvertedImageWriter{
+public:
+    enum Format{TIFF_16,FLOAT_RAW};
+
+    ConvertedImageWriter();
+
+    /**
+     * @brief formatFromPath choose a format from a file extension
+     * @param path
+     * @return TIFF_16 for .tif and .tiff files, FLOAT_RAW otherwise
+     */
+    static Format formatFromPath(string path);
+    /**
+     * @brief open create the output files
+     * @param path
+     * @param format
+     * @param width image width
+     * @param height image height
+     * @param names name of each channel (FLOAT_RAW files names)
+     * @return false if the files can't be created, or the image is too big for a tiff (4GB)
+     */
+    bool open(string path, Format format, size_t width, size_t height, const string names[3]);
+    /**
+     * @brief write write the next pixels
+     * @param c1 first channel values
+     * @param c2 second channel values
+     * @param c3 third channel values
+     * @param count number of pixels
+     * @return false on write error
+     */
+    bool write(const float* c1, const float* c2, const float* c3, size_t count);
+    /**
+     * @brief close close the files
+     * @return false if a write failed or not all the pixels were written
+     */
+    bool close();
+private:
+    /**
+     * @brief writeTiffHeader write header, directory and tags of the tiff, pixels follow
+     * @param width
+     * @param height
+     */
+    void writeTiffHeader(size_t width, size_t height);
+    /**
+     * @brief writeTiffEntry write a tiff directory entry with a single value (or an offset)
+     * @param tag
+     * @param type 3 (SHORT) or 4 (LONG)
+     * @param count number of values
+     * @param value value, or offset of the values if they don't fit in 4 bytes
+     */
+    void writeTiffEntry(uint16_t tag, uint16_t type, uint32_t count, uint32_t value);
+
+    Format format;/*!< format of the opened files*/
+    ofstream files[3];/*!< the tiff, or one file by channel*/
+    size_t remaining;/*!< number of pixels not yet written*/
+};
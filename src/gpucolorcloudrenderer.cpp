@@ -0,0 +1,310 @@
+#include "gpucolorcloudrenderer.h"
+
+#define STRINGIFY(A) #A
+
+//same computations than the compute functions of the color spaces, in the
+//order of cs::createColorspace
+static const char* vertexShader="#version 120\n" POINT_FILTER_GLSL STRINGIFY(
+    //packed key 0xRRGGBB read as 4 normalized bytes : blue, green, red, 0
+    attribute vec4 key;
+    attribute vec4 color;
+    uniform int space;
+    uniform vec3 scale;
+    uniform vec3 offset;
+    //blend of color spaces at the start of the morph
+    uniform float startWeights[8];
+    uniform vec3 startScales[8];
+    uniform vec3 startOffsets[8];
+    uniform float morph;
+    varying vec4 pointColor;
+    //normalized coordinates, read back by computeCoordinates
+    varying vec3 coordinates;
+
+    const float PI=3.14159265358979;
+    //xyz of rgb white (255,255,255), reference white of Luv and Lab
+    const vec3 WHITE=vec3(250.155,255.,301.41);
+
+    vec3 toXYZ(vec3 c){
+        return vec3(dot(c,vec3(0.607,0.174,0.200)),
+                    dot(c,vec3(0.299,0.587,0.114)),
+                    dot(c,vec3(0.,0.066,1.116)));
+    }
+
+    float lightness(float yr){
+        return yr>0.008856 ? 116.*pow(yr,1./3.)-16. : 903.3*yr;
+    }
+
+    float labF(float t){
+        return t>0.008856 ? pow(t,1./3.) : 7.787*t+16./116.;
+    }
+
+    //round half away from zero to 1/1000, round() is not in GLSL 1.20
+    float round1000(float v){
+        return sign(v)*floor(abs(v)*1000.+0.5)/1000.;
+    }
+
+    vec3 luv(vec3 c){
+        vec3 xyz=toXYZ(c);
+        float l=lightness(xyz.y/WHITE.y);
+        float d=dot(xyz,vec3(1.,15.,3.));
+        if(d==0.){
+            return vec3(l,0.,0.);
+        }
+        float dWhite=dot(WHITE,vec3(1.,15.,3.));
+        return vec3(l,13.*l*(4.*xyz.x/d-4.*WHITE.x/dWhite),13.*l*(9.*xyz.y/d-9.*WHITE.y/dWhite));
+    }
+
+    vec3 lab(vec3 c){
+        vec3 r=toXYZ(c)/WHITE;
+        float fy=labF(r.y);
+        return vec3(lightness(r.y),500.*(labF(r.x)-fy),500.*(fy-labF(r.z)));
+    }
+
+    vec3 hsi(vec3 c){
+        float h=PI;
+        float s=0.;
+        if(c.r!=c.g || c.g!=c.b){
+            float rg=c.r-c.g;
+            float rb=c.r-c.b;
+            float gb=c.g-c.b;
+            h=acos(clamp(0.5*(rg+rb)/sqrt(rg*rg+rb*gb),-1.,1.));
+            if(c.b>c.g){
+                h=2.*PI-h;
+            }
+            s=1.-3.*min(c.r,min(c.g,c.b))/(c.r+c.g+c.b);
+        }
+        return vec3(h,s,(c.r+c.g+c.b)/3.);
+    }
+
+    vec3 convert(vec3 c, int s){
+        float sum=c.r+c.g+c.b;
+        if(s==0){
+            return toXYZ(c);
+        }else if(s==1){
+            return luv(c);
+        }else if(s==2){
+            return lab(c);
+        }else if(s==3){
+            return vec3(sum/3.,round1000(0.8660254*(c.r-c.g)),c.b-0.5*(c.r+c.g));
+        }else if(s==4){
+            return vec3(sum/3.,round1000(c.r-0.5*(c.g+c.b)),0.8660254*(c.b-c.g));
+        }else if(s==5){
+            return hsi(c);
+        }else if(s==6){
+            return vec3(sum/3.,0.5*(c.r-c.b),0.25*(2.*c.r-c.g-c.b));
+        }
+        return vec3(c.r+c.g,c.r-c.g,c.b-0.5*(c.r+c.g));
+    }
+
+    vec3 normalizedCoordinates(vec3 c, int s, vec3 sScale, vec3 sOffset){
+        vec3 n=convert(c,s)*sScale+sOffset;
+        if(s==1 || s==2){
+            //Luv and Lab chromaticities are clamped to their ranges
+            n.yz=clamp(n.yz,0.,1.);
+        }
+        return n;
+    }
+
+    void main(){
+        //exact 8 bits values, as the CPU conversion
+        vec3 rgb=floor(key.zyx*255.+0.5);
+        vec3 n=normalizedCoordinates(rgb,space,scale,offset);
+        if(morph<1.){
+            vec3 start=vec3(0.);
+            for(int s=0;s<8;s++){
+                if(startWeights[s]>0.){
+                    start+=startWeights[s]*normalizedCoordinates(rgb,s,startScales[s],startOffsets[s]);
+                }
+            }
+            n=mix(start,n,morph);
+        }
+        coordinates=n;
+        pointColor=vec4(color.z,color.y,color.x,1.);
+        //filtered points are moved out of the clip volume
+        gl_Position= accepted(n) ? gl_ModelViewProjectionMatrix*vec4(n,1.) : vec4(2.,2.,2.,1.);
+    }
+);
+
+static const char* fragmentShader="#version 120\n" STRINGIFY(
+    varying vec4 pointColor;
+    void main(){
+        gl_FragColor=pointColor;
+    }
+);
+
+GpuColorCloudRenderer::GpuColorCloudRenderer(){
+    ready=false;
+    feedbackReady=false;
+    hasColors=false;
+    count=0;
+    hasStart=false;
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        startWeights[s]=0;
+    }
+    fill(startScales,startScales+3*cs::COLORSPACE_COUNT,0.f);
+    fill(startOffsets,startOffsets+3*cs::COLORSPACE_COUNT,0.f);
+}
+
+GpuColorCloudRenderer::~GpuColorCloudRenderer(){
+    if(ready){
+        glDeleteBuffers(PLANE_COUNT,buffers);
+    }
+}
+
+void GpuColorCloudRenderer::setup(){
+    glGenBuffers(PLANE_COUNT,buffers);
+    shader.setupShaderFromSource(GL_VERTEX_SHADER,vertexShader);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER,fragmentShader);
+    shader.bindAttribute(KEY_PLANE,"key");
+    shader.bindAttribute(COLOR_PLANE,"color");
+    shader.linkProgram();
+    ready=true;
+}
+
+bool GpuColorCloudRenderer::computeCoordinates(const cs::ColorspaceInterface& space, int spaceIndex, const uint32_t* keys,
+                                               size_t n, float* c1, float* c2, float* c3){
+    if(!feedbackReady){
+        //transform feedback is core since GL 3.0
+        if(!GLEW_VERSION_3_0){
+            return false;
+        }
+        feedbackShader.setupShaderFromSource(GL_VERTEX_SHADER,vertexShader);
+        feedbackShader.bindAttribute(KEY_PLANE,"key");
+        feedbackShader.bindAttribute(COLOR_PLANE,"color");
+        const char* varyings[]={"coordinates"};
+        glTransformFeedbackVaryings(feedbackShader.getProgram(),1,varyings,GL_INTERLEAVED_ATTRIBS);
+        feedbackShader.linkProgram();
+        feedbackReady=true;
+    }
+    GLuint keyBuffer;
+    GLuint coordinateBuffer;
+    glGenBuffers(1,&keyBuffer);
+    glGenBuffers(1,&coordinateBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER,keyBuffer);
+    glBufferData(GL_ARRAY_BUFFER,n*sizeof(uint32_t),keys,GL_STREAM_DRAW);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,coordinateBuffer);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,3*n*sizeof(float),NULL,GL_STREAM_READ);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER,0,coordinateBuffer);
+
+    double scale[3];
+    double offset[3];
+    space.getNormalization(scale,offset);
+    feedbackShader.begin();
+    feedbackShader.setUniform1i("space",spaceIndex);
+    feedbackShader.setUniform3f("scale",scale[0],scale[1],scale[2]);
+    feedbackShader.setUniform3f("offset",offset[0],offset[1],offset[2]);
+    feedbackShader.setUniform1f("morph",1.f);
+    glBindBuffer(GL_ARRAY_BUFFER,keyBuffer);
+    glEnableVertexAttribArray(KEY_PLANE);
+    glVertexAttribPointer(KEY_PLANE,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+    glEnableVertexAttribArray(COLOR_PLANE);
+    glVertexAttribPointer(COLOR_PLANE,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+    //vertices are only transformed, nothing is drawn
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS,0,n);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    glDisableVertexAttribArray(KEY_PLANE);
+    glDisableVertexAttribArray(COLOR_PLANE);
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    feedbackShader.end();
+
+    const float* coordinates=(const float*)glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER,0,3*n*sizeof(float),GL_MAP_READ_BIT);
+    bool mapped= coordinates!=NULL;
+    if(mapped){
+        for(size_t i=0;i<n;i++){
+            c1[i]=coordinates[3*i];
+            c2[i]=coordinates[3*i+1];
+            c3[i]=coordinates[3*i+2];
+        }
+        glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+    }
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,0);
+    glDeleteBuffers(1,&keyBuffer);
+    glDeleteBuffers(1,&coordinateBuffer);
+    return mapped;
+}
+
+void GpuColorCloudRenderer::upload(const uint32_t* keys, const uint32_t* colors, size_t n){
+    if(!ready){
+        setup();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,buffers[KEY_PLANE]);
+    glBufferData(GL_ARRAY_BUFFER,n*sizeof(uint32_t),keys,GL_STATIC_DRAW);
+    hasColors= colors!=NULL;
+    if(hasColors){
+        glBindBuffer(GL_ARRAY_BUFFER,buffers[COLOR_PLANE]);
+        glBufferData(GL_ARRAY_BUFFER,n*sizeof(uint32_t),colors,GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    count=n;
+}
+
+void GpuColorCloudRenderer::setFilter(const PointFilter& filter){
+    this->filter=filter;
+}
+
+void GpuColorCloudRenderer::clear(){
+    count=0;
+}
+
+void GpuColorCloudRenderer::startMorph(const cs::ColorspaceInterface& space, int spaceIndex, float morph){
+    //points drawn at morph : the start keeps 1-morph of its weight, the end gets the rest
+    float kept= hasStart && morph<1 ? 1.f-morph : 0.f;
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        startWeights[s]*=kept;
+    }
+    double scale[3];
+    double offset[3];
+    space.getNormalization(scale,offset);
+    //a color space already in the start, with other ranges, gets their weighted mean
+    float previous=startWeights[spaceIndex];
+    float added=1.f-kept;
+    float total=previous+added;
+    for(int c=0;c<3;c++){
+        float* startScale=&startScales[3*spaceIndex+c];
+        float* startOffset=&startOffsets[3*spaceIndex+c];
+        *startScale=(previous*(*startScale)+added*float(scale[c]))/total;
+        *startOffset=(previous*(*startOffset)+added*float(offset[c]))/total;
+    }
+    startWeights[spaceIndex]=total;
+    hasStart=true;
+}
+
+void GpuColorCloudRenderer::draw(const cs::ColorspaceInterface& space, int spaceIndex, float morph){
+    if(!ready || count==0){
+        return;
+    }
+    double scale[3];
+    double offset[3];
+    space.getNormalization(scale,offset);
+
+    shader.begin();
+    shader.setUniform1i("space",spaceIndex);
+    shader.setUniform3f("scale",scale[0],scale[1],scale[2]);
+    shader.setUniform3f("offset",offset[0],offset[1],offset[2]);
+    if(hasStart && morph<1){
+        shader.setUniform1fv("startWeights",startWeights,cs::COLORSPACE_COUNT);
+        shader.setUniform3fv("startScales",startScales,cs::COLORSPACE_COUNT);
+        shader.setUniform3fv("startOffsets",startOffsets,cs::COLORSPACE_COUNT);
+        shader.setUniform1f("morph",morph);
+    }else{
+        shader.setUniform1f("morph",1.f);
+    }
+    filter.setUniforms(shader);
+    glBindBuffer(GL_ARRAY_BUFFER,buffers[KEY_PLANE]);
+    glEnableVertexAttribArray(KEY_PLANE);
+    glVertexAttribPointer(KEY_PLANE,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+    //without display colors, the key buffer gives the color too
+    glBindBuffer(GL_ARRAY_BUFFER,buffers[hasColors ? COLOR_PLANE : KEY_PLANE]);
+    glEnableVertexAttribArray(COLOR_PLANE);
+    glVertexAttribPointer(COLOR_PLANE,4,GL_UNSIGNED_BYTE,GL_TRUE,0,0);
+
+    glDrawArrays(GL_POINTS,0,count);
+
+    glDisableVertexAttribArray(KEY_PLANE);
+    glDisableVertexAttribArray(COLOR_PLANE);
+    glBindBuffer(GL_ARRAY_BUFFER,0);
+    shader.end();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+#include "colorspace/colorspaces.h"
+#include "pointfilter.h"
+
+/**
+ * @brief The GpuColorCloudRenderer class draw colors as points, converted to a
+ * color space by the vertex shader
+ *
+ * Colors are uploaded once, as packed 8 bits keys (0xRRGGBB, 4 bytes by point),
+ * and the shader computes their coordinates in the color space given to draw :
+ * changing the color space is a uniform change, without any conversion nor
+ * upload on the CPU side. A morph converts to the color space and to the
+ * color spaces of its start, and interpolates : the start is a weighted blend
+ * of color spaces, so a morph retargeted before its end starts from the points
+ * as drawn.
+ *
+ * The shader implements the compute function of each color space of
+ * cs::createColorspace, in float (GLSL 1.20, runs on Mesa llvmpipe). main
+ * --validate-gpu compares it to the reference formulas on the whole 8 bits rgb
+ * cube (see computeCoordinates). Black has no chromaticity in Luv : NaN on the
+ * CPU, u=v=0 on the GPU.
+ */
+class GpuColorCloudRenderer{
+public:
+    GpuColorCloudRenderer();
+    ~GpuColorCloudRenderer();
+    /**
+     * @brief upload upload the colors
+     * @param keys packed (0xRRGGBB) colors, converted by the shader
+     * @param colors packed (0xRRGGBB) display color of each point, NULL to display the keys
+     * @param n number of points
+     */
+    void upload(const uint32_t* keys, const uint32_t* colors, size_t n);
+    /**
+     * @brief draw draw points at their normalized coordinates, inside a camera
+     * (the model matrix places the normalized color space)
+     * @param space color space giving the normalization of the coordinates
+     * @param spaceIndex index of the color space (see cs::createColorspace), select the conversion
+     * @param morph position between the morph start (0, see startMorph) and space (1)
+     */
+    void draw(const cs::ColorspaceInterface& space, int spaceIndex, float morph=1);
+    /**
+     * @brief startMorph keep the points as drawn at a position of the current
+     * morph as the start of a new morph
+     * @param space color space of the current morph end, with its current ranges
+     * @param spaceIndex index of the color space (see cs::createColorspace)
+     * @param morph position in the current morph (see draw), 1 if there is none
+     */
+    void startMorph(const cs::ColorspaceInterface& space, int spaceIndex, float morph);
+    /**
+     * @brief computeCoordinates normalized coordinates computed by the shader,
+     * read back with transform feedback (GL 3.0), to check the shader against
+     * the CPU conversions
+     * @param space color space giving the normalization of the coordinates
+     * @param spaceIndex index of the color space (see cs::createColorspace)
+     * @param keys packed (0xRRGGBB) colors
+     * @param n number of colors
+     * @param c1 first normalized channel of each color
+     * @param c2 second normalized channel of each color
+     * @param c3 third normalized channel of each color
+     * @return false without transform feedback
+     */
+    bool computeCoordinates(const cs::ColorspaceInterface& space, int spaceIndex, const uint32_t* keys, size_t n,
+                            float* c1, float* c2, float* c3);
+    /**
+     * @brief clear draw nothing until next upload
+     */
+    void clear();
+    /**
+     * @brief setFilter hide the points rejected by a filter, from the next draw
+     * @param filter
+     */
+    void setFilter(const PointFilter& filter);
+private:
+    /**
+     * @brief setup create buffers and shader, needs a GL context
+     */
+    void setup();
+    enum Plane{KEY_PLANE,COLOR_PLANE,PLANE_COUNT};
+    bool ready;/*!< true once buffers and shader are created*/
+    GLuint buffers[PLANE_COUNT];/*!< one vertex buffer by plane*/
+    bool hasColors;/*!< true if display colors differ from the keys*/
+    size_t count;/*!< number of uploaded points*/
+    bool hasStart;/*!< true once a morph start is set*/
+    float startWeights[cs::COLORSPACE_COUNT];/*!< weight of each color space in the morph start*/
+    float startScales[3*cs::COLORSPACE_COUNT];/*!< normalization scale of each color space in the morph start*/
+    float startOffsets[3*cs::COLORSPACE_COUNT];/*!< normalization offset of each color space in the morph start*/
+    ofShader shader;/*!< coordinates and color from keys*/
+    bool feedbackReady;/*!< true once feedbackShader is created*/
+    ofShader feedbackShader;/*!< same shader, its normalized coordinates captured by transform feedback*/
+    PointFilter filter;/*!< hidden points, in the normalized coordinates of the drawn color space*/
+};
@@ -1,17 +1,202 @@
 #include "ofMain.h"
 #include "ofApp.h"
-#include "colorspace/colorspaceinterface.h"
+#include "renderjob.h"
+#include "gpucolorcloudrenderer.h"
+#include "colorspace/conversionvalidation.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 
-//========================================================================
-int main( ){
-    ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
+/**
+ * @brief printConversionReport print the differences of a batch conversion
+ * @param name color space name
+ * @param precision "float" or "double", followed by the input depth
+ * @param report
+ * @param tolerance largest accepted difference, as a part of the channel range
+ * @param undefinedAllowed if true, values where the reference is undefined (NaN) are accepted
+ * @return true if the differences are within tolerance
+ */
+static bool printConversionReport(const string& name, const string& precision, const cs::ConversionReport& report,
+                                  double tolerance, bool undefinedAllowed=false){
+    bool passed=report.maxNormalizedError<=tolerance;
+    for(int c=0;c<3;c++){
+        const cs::ChannelError& channel=report.channels[c];
+        passed=passed && channel.nanMismatches==0 && (undefinedAllowed || channel.undefinedValues==0);
+        char line[200];
+        snprintf(line,sizeof(line),"%-7s %-10s c%d  max %9.3g  mean %9.3g  worst #%06X  NaN mismatches %zu  undefined values %zu",
+                 name.c_str(),precision.c_str(),c+1,channel.maxError,channel.meanError,
+                 channel.worstColor,channel.nanMismatches,channel.undefinedValues);
+        cout<<line<<endl;
+    }
+    cout<<name<<" "<<precision<<(passed ? " passed" : " FAILED")<<" (max "<<report.maxNormalizedError<<
+          " of the ranges, tolerance "<<tolerance<<")"<<endl;
+    return passed;
+}
 
-    // this kicks off the running of my app
-    // can be OF_WINDOW or OF_FULLSCREEN
-    // pass in width and height too:
-    ofRunApp(new ColorspaceDisplayer());
+/**
+ * @brief validateGpuConversions compare the coordinates computed by the shader
+ * of GpuColorCloudRenderer to the reference, on all the 8 bits rgb colors
+ *
+ * A hidden window gives the GL context : without display, run it in a virtual
+ * one (xvfb-run) with a software GL (llvmpipe). Kept out of validateConversions
+ * so the CPU check needs no GL.
+ * @return process exit code, 0 if every conversion is within tolerance, 1 too
+ * if the shader could not be run
+ */
+static int validateGpuConversions(){
+    ofGLFWWindowSettings settings;
+    settings.width=64;
+    settings.height=64;
+    settings.visible=false;
+    ofCreateWindow(settings);
+    if(glGetString(GL_VERSION)==NULL){
+        cout<<"gpu    no GL context, shader not validated"<<endl;
+        return 1;
+    }
+    //GLSL float, HSI hue (GPU acos) is the least precise channel
+    const double gpuTolerance=1e-4;
+    GpuColorCloudRenderer renderer;
+    bool passed=true;
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        cs::ColorspaceInterface* space=cs::createColorspace(s);
+        string name=space->getName();
+        double scale[3];
+        double offset[3];
+        space->getNormalization(scale,offset);
+        bool computed=true;
+        //one transform feedback by block, read back in the units of the color space
+        const size_t blockSize=size_t(1)<<20;
+        vector<uint32_t> keys(blockSize);
+        cs::ConversionReport report=cs::compareToReference<float>(s,size_t(1)<<24,blockSize,false,
+                                                                  [&](size_t first, size_t n, double* rgb, float* c1, float* c2, float* c3){
+            for(size_t i=0;i<n;i++){
+                keys[i]=uint32_t(first+i);
+                rgb[3*i]=(keys[i]>>16) & 0xff;
+                rgb[3*i+1]=(keys[i]>>8) & 0xff;
+                rgb[3*i+2]=keys[i] & 0xff;
+            }
+            float* planes[3]={c1,c2,c3};
+            computed=renderer.computeCoordinates(*space,s,keys.data(),n,c1,c2,c3) && computed;
+            for(int c=0;c<3;c++){
+                for(size_t i=0;i<n;i++){
+                    planes[c][i]=float((planes[c][i]-offset[c])/scale[c]);
+                }
+            }
+        });
+        delete space;
+        if(!computed){
+            cout<<"gpu    no transform feedback, shader not validated"<<endl;
+            return 1;
+        }
+        //black has no chromaticity in Luv : NaN on the CPU, 0 on the GPU
+        passed=printConversionReport(name,"gpu",report,gpuTolerance,true) && passed;
+    }
+    cout<<(passed ? "all gpu conversions passed" : "some gpu conversions FAILED")<<endl;
+    return passed ? 0 : 1;
+}
+
+/**
+ * @brief validateConversions compare the float and double batch conversions
+ * of every color space to their reference, on all the 8 bits rgb colors and on
+ * 16 bits colors, without GL (see validateGpuConversions for the shader)
+ * @return process exit code, 0 if every conversion is within tolerance
+ */
+static int validateConversions(){
+    //float keeps 24 bits of mantissa, double batch conversion runs the formulas of the reference
+    const double floatTolerance=1e-5;
+    const double doubleTolerance=1e-9;
+    //16 bits colors reach the gray levels where the HSI hue loses most (see BatchConverter)
+    const double deepFloatTolerance=2e-4;
+    bool passed=true;
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        cs::ColorspaceInterface* space=cs::createColorspace(s);
+        string name=space->getName();
+        delete space;
+        passed=printConversionReport(name,"float u8",cs::validateConversion<float>(s),floatTolerance) && passed;
+        passed=printConversionReport(name,"double u8",cs::validateConversion<double>(s),doubleTolerance) && passed;
+        passed=printConversionReport(name,"float u16",cs::validateBufferConversion<float>(s),deepFloatTolerance) && passed;
+        passed=printConversionReport(name,"double u16",cs::validateBufferConversion<double>(s),doubleTolerance) && passed;
+    }
+    cout<<(passed ? "all conversions passed" : "some conversions FAILED")<<endl;
+    return passed ? 0 : 1;
+}
 
+/**
+ * @brief parseThreadOptions read and remove --threads N and --pin-threads from arguments
+ * @param args arguments, without the program name
+ * @param threads number of threads of the parallel stages, 0 for the number of cores
+ * @param pinned true if each thread runs on its own core
+ * @param error why parsing failed
+ * @return false on invalid value
+ */
+static bool parseThreadOptions(vector<string>& args, unsigned int& threads, bool& pinned, string& error){
+    threads=0;
+    pinned=false;
+    vector<string> others;
+    for(size_t i=0;i<args.size();i++){
+        if(args[i]=="--threads"){
+            int n= i+1<args.size() ? atoi(args[i+1].c_str()) : 0;
+            if(n<=0){
+                error="--threads needs a positive number";
+                return false;
+            }
+            threads=n;
+            i++;
+        }else if(args[i]=="--pin-threads"){
+            pinned=true;
+        }else{
+            others.push_back(args[i]);
+        }
+    }
+    args.swap(others);
+    return true;
 }
 
+//========================================================================
+int main(int argc, char* argv[]){
+    vector<string> args(argv+1,argv+argc);
+    unsigned int threads;
+    bool pinThreads;
+    string error;
+    if(!parseThreadOptions(args,threads,pinThreads,error)){
+        cerr<<error<<endl<<getRenderUsage();
+        return 1;
+    }
+    if(find(args.begin(),args.end(),"--validate")!=args.end()){
+        cs::ThreadPool pool(threads,pinThreads);
+        cs::ThreadPool::setCurrent(&pool);
+        return validateConversions();
+    }
+    if(find(args.begin(),args.end(),"--validate-gpu")!=args.end()){
+        cs::ThreadPool pool(threads,pinThreads);
+        cs::ThreadPool::setCurrent(&pool);
+        return validateGpuConversions();
+    }
+    vector<RenderJob> jobs;
+    if(!parseRenderJobs(args,jobs,error)){
+        cerr<<error<<endl<<getRenderUsage();
+        return 1;
+    }
+
+    if(jobs.empty()){
+        ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
+
+        // this kicks off the running of my app
+        // can be OF_WINDOW or OF_FULLSCREEN
+        // pass in width and height too:
+        ofRunApp(new ColorspaceDisplayer(jobs,threads,pinThreads));
+        return 0;
+    }
+
+    //headless mode : a hidden window gives the GL context, renders go to a fbo.
+    //Without display, run it in a virtual one (xvfb-run) with a software GL (llvmpipe)
+    ofGLFWWindowSettings settings;
+    settings.width=1024;
+    settings.height=768;
+    settings.visible=false;
+    ofCreateWindow(settings);
+    ofRunApp(new ColorspaceDisplayer(jobs,threads,pinThreads));
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "mappedfile.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(){
+    mapping=NULL;
+    mappingSize=0;
+}
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+bool MappedFile::open(string path){
+    close();
+
+#ifndef _WIN32
+    int fd=::open(path.c_str(),O_RDONLY);
+    if(fd<0){
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd,&info)!=0 || info.st_size==0){
+        ::close(fd);
+        return false;
+    }
+    mappingSize=size_t(info.st_size);
+    void* address=mmap(NULL,mappingSize,PROT_READ,MAP_PRIVATE,fd,0);
+    //the mapping stays valid once the file is closed
+    ::close(fd);
+    if(address==MAP_FAILED){
+        mappingSize=0;
+        return false;
+    }
+    mapping=static_cast<unsigned char*>(address);
+    //bytes are read once, from first to last
+    madvise(mapping,mappingSize,MADV_SEQUENTIAL);
+    madvise(mapping,mappingSize,MADV_WILLNEED);
+#else
+    ifstream file(path.c_str(),ios::binary);
+    if(!file){
+        return false;
+    }
+    fallback.assign(istreambuf_iterator<char>(file),istreambuf_iterator<char>());
+    if(fallback.empty()){
+        return false;
+    }
+    mapping=&fallback[0];
+    mappingSize=fallback.size();
+#endif
+    return true;
+}
+
+void MappedFile::close(){
+#ifndef _WIN32
+    if(mapping!=NULL){
+        munmap(mapping,mappingSize);
+    }
+#else
+    fallback.clear();
+#endif
+    mapping=NULL;
+    mappingSize=0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+/**
+ * @brief The MappedFile class read-only memory mapping of a whole file
+ *
+ * The kernel is told the file will be read sequentially. Where mmap is not
+ * available (windows), the file is read in memory instead.
+ */
+class MappedFile{
+public:
+    MappedFile();
+    ~MappedFile();
+    /**
+     * @brief open map a file
+     * @param path
+     * @return false if the file can't be read or is empty
+     */
+    bool open(string path);
+    /**
+     * @brief close unmap the file
+     */
+    void close();
+    /**
+     * @brief data
+     * @return first byte of the file, NULL if no file is mapped
+     */
+    const unsigned char* data() const{
+        return mapping;
+    }
+    /**
+     * @brief size
+     * @return size of the file in bytes
+     */
+    size_t size() const{
+        return mappingSize;
+    }
+    bool isOpen() const{
+        return mapping!=NULL;
+    }
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    unsigned char* mapping;/*!< whole mapped file*/
+    size_t mappingSize;/*!< size of the mapped file*/
+    vector<unsigned char> fallback;/*!< file content where mmap is unavailable*/
+};
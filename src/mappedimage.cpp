@@ -0,0 +1,106 @@
+#include "mappedimage.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+MappedImage::MappedImage(){
+    pixels=NULL;
+    pixelCount=0;
+    width=0;
+    height=0;
+}
+
+MappedImage::~MappedImage(){
+    close();
+}
+
+static string extension(string path){
+    size_t dot=path.find_last_of('.');
+    if(dot==string::npos){
+        return "";
+    }
+    string ext=path.substr(dot+1);
+    transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+    return ext;
+}
+
+bool MappedImage::isMappable(string path){
+    string ext=extension(path);
+    return ext=="ppm" || ext=="rgb" || ext=="raw";
+}
+
+bool MappedImage::open(string path){
+    close();
+    if(!file.open(path)){
+        return false;
+    }
+
+    size_t offset=0;
+    if(extension(path)=="ppm"){
+        offset=parsePPMHeader();
+        //3*width*height can overflow for absurd header dimensions
+        size_t available= offset<file.size() ? (file.size()-offset)/3 : 0;
+        if(offset==0 || (width>0 && height>available/width)){
+            close();
+            return false;
+        }
+        pixelCount=width*height;
+    }else{
+        pixelCount=file.size()/3;
+        width=pixelCount;
+        height=1;
+    }
+    pixels=file.data()+offset;
+    return true;
+}
+
+size_t MappedImage::parsePPMHeader(){
+    //P6 <whitespaces> width <whitespaces> height <whitespaces> maxval <one whitespace>
+    //comments start with # and end with the line
+    const unsigned char* data=file.data();
+    size_t size=file.size();
+    if(size<2 || data[0]!='P' || data[1]!='6'){
+        return 0;
+    }
+    size_t pos=2;
+    size_t values[3];
+    for(int i=0;i<3;i++){
+        while(pos<size && (isspace(data[pos]) || data[pos]=='#')){
+            if(data[pos]=='#'){
+                while(pos<size && data[pos]!='\n'){
+                    pos++;
+                }
+            }else{
+                pos++;
+            }
+        }
+        if(pos>=size || !isdigit(data[pos])){
+            return 0;
+        }
+        values[i]=0;
+        while(pos<size && isdigit(data[pos])){
+            if(values[i]>(SIZE_MAX-9)/10){
+                return 0;
+            }
+            values[i]=values[i]*10+(data[pos]-'0');
+            pos++;
+        }
+    }
+    //pixels are used in place : 16 bits samples (big endian) and samples of
+    //an other maxval would need a copy to be rescaled
+    if(pos>=size || !isspace(data[pos]) || values[2]!=255){
+        return 0;
+    }
+    width=values[0];
+    height=values[1];
+    return pos+1;
+}
+
+void MappedImage::close(){
+    file.close();
+    pixels=NULL;
+    pixelCount=0;
+    width=0;
+    height=0;
+}
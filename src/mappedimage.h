@@ -0,0 +1,80 @@
+#pragma once
+
+#include "mappedfile.h"
+
+/**
+ * @brief The MappedImage class read-only memory mapping of a raw rgb image
+ *
+ * Supported files :
+ *  + binary PPM (P6) with 8 bits samples (maxval 255)
+ *  + raw dumps (.rgb, .raw) : interleaved 8 bits red, green, blue, no header
+ *
+ * Pixels are not decoded nor copied : data() points into the mapped file and can
+ * be given directly to the dedup scan or to the batch converter. The file is
+ * mapped for sequential reading (see MappedFile), so ingestion runs at page
+ * cache speed.
+ */
+class MappedImage{
+public:
+    MappedImage();
+    ~MappedImage();
+    /**
+     * @brief isMappable test if a file can be opened by MappedImage, by its extension
+     * @param path
+     * @return true for .ppm, .rgb and .raw files
+     */
+    static bool isMappable(string path);
+    /**
+     * @brief open map a file
+     * @param path
+     * @return false if the file can't be read or is not a supported format
+     */
+    bool open(string path);
+    /**
+     * @brief close unmap the file
+     */
+    void close();
+    /**
+     * @brief data
+     * @return interleaved rgb pixels, 3 bytes per pixel
+     */
+    const unsigned char* data() const{
+        return pixels;
+    }
+    /**
+     * @brief getPixelCount
+     * @return number of pixels
+     */
+    size_t getPixelCount() const{
+        return pixelCount;
+    }
+    /**
+     * @brief getWidth
+     * @return image width, for raw dumps the whole image is a single line
+     */
+    size_t getWidth() const{
+        return width;
+    }
+    /**
+     * @brief getHeight
+     * @return image height
+     */
+    size_t getHeight() const{
+        return height;
+    }
+private:
+    MappedImage(const MappedImage&);
+    MappedImage& operator=(const MappedImage&);
+    /**
+     * @brief parsePPMHeader read header of a binary PPM
+     * @return offset of the pixels in the file, 0 if the header is not valid or
+     * maxval is not 255
+     */
+    size_t parsePPMHeader();
+
+    MappedFile file;/*!< whole mapped file*/
+    const unsigned char* pixels;/*!< first pixel*/
+    size_t pixelCount;/*!< number of pixels*/
+    size_t width;/*!< image width*/
+    size_t height;/*!< image height*/
+};
@@ -1,28 +1,150 @@
 #include "ofApp.h"
-#include "colorspace/xyz.h"
-#include "colorspace/luv.h"
-#include "colorspace/lab.h"
-#include "colorspace/ac1c2.h"
-#include "colorspace/yc1c2.h"
-#include "colorspace/hsi.h"
-#include "colorspace/i1i2i3.h"
-#include "colorspace/h1h2h3.h"
+#include "colorspace/colorspaces.h"
+#include "colorspace/sparsecolorcounter.h"
+#include "mappedimage.h"
+#include "colorspace/parallel.h"
+#include "colorspace/multiconverter.h"
+#include "colorspace/colorselection.h"
 
 
 
 
-#include <set>
-ColorspaceDisplayer::ColorspaceDisplayer(){
-    currentColorSpace=new cs::XYZ();
-    xAxisName="X";
-    yAxisName="Y";
-    zAxisName="Z";
+/**
+ * @brief MORPH_FRAMES duration of a morph between color spaces, in frames
+ */
+static const int MORPH_FRAMES=60;
+
+/**
+ * @brief SQUARE_SIZE half size of the squares of the sparse color space, in the normalized color space
+ */
+static const float SQUARE_SIZE=0.005f;
+
+/**
+ * @brief CUBE_CENTER center of the normalized color space
+ */
+static const ofVec3f CUBE_CENTER(0.5f,0.5f,0.5f);
+
+/**
+ * @brief PICK_RADIUS maximal distance between the mouse ray and a picked color, in the normalized color space
+ */
+static const float PICK_RADIUS=0.008f;
+
+/**
+ * @brief IMAGE_VIEW_SIZE largest side of the image view, in pixels : brushing
+ * costs the same whatever the size of the image
+ */
+static const size_t IMAGE_VIEW_SIZE=2048;
+
+/**
+ * @brief MASK_DIM rgba value (little endian) of the mask over pixels whose color is not selected
+ */
+static const uint32_t MASK_DIM=0xc0000000;
+
+/**
+ * @brief VOLUME_RESOLUTION number of cells along each axis of the density grid
+ */
+static const int VOLUME_RESOLUTION=128;
+
+/**
+ * @brief AXIS_NAMES names of the channels of each color space, in cs::createColorspace order
+ */
+static const char* AXIS_NAMES[cs::COLORSPACE_COUNT][3]={
+    {"X","Y","Z"},{"L","U","V"},{"L","A","B"},{"A","C1","C2"},
+    {"Y","C1","C2"},{"H","S","I"},{"I1","I2","I3"},{"H1","H2","H3"}};
+
+/**
+ * @brief RANGE_MODE_NAMES names of the range modes, in RANGE_MODE order
+ */
+static const char* RANGE_MODE_NAMES[3]={"default","exact","fitted to the image"};
+
+ColorspaceDisplayer::ColorspaceDisplayer(const vector<RenderJob>& renderJobs, unsigned int threads, bool pinThreads):
+    threadPool(threads,pinThreads),renderJobs(renderJobs){
+    //every parallel loop, from now on, runs on the threads of the application
+    cs::ThreadPool::setCurrent(&threadPool);
+    conversionSpace=NULL;
+    conversionIndex=-1;
+    conversionMorph=false;
+    conversionStart=0;
+    conversionTime=0;
+    currentColorSpace=NULL;
+    rangeMode=DEFAULT_RANGES;
+    for(int i=0;i<cs::COLORSPACE_COUNT;i++){
+        cs::ColorspaceInterface* defaultSpace=cs::createColorspace(i);
+        defaultSpace->getChannelRanges(defaultLow[i],defaultHigh[i]);
+        delete defaultSpace;
+        exactRangesKnown[i]=false;
+    }
+    sweepIndex=-1;
+    sweepStart=0;
+    sweepTime=0;
     mode=SPARSE_CS;
+    setColorspace(0);
+    comparisonOperation=cs::GamutComparison::UNION;
+    voxelVolume=0;
+    gamutTime=0;
+    showHull=false;
+    lastFrameStart=0;
+    showProfiler=false;
+    splitLayout=1;
+    splitDirty=true;
+    splitHullsDirty=true;
+    gpuConversion=false;
+    volumeRendering=false;
+    volumeDirty=true;
+    showStats=false;
+    morphEnabled=false;
+    morphStartFrame=0;
+    pickGridDirty=true;
+    hoveredColor=-1;
+    pickedColor=-1;
+    showImageView=false;
+    showFilter=false;
+    brushedPixels=0;
+    brushing=false;
+    for(int i=0;i<cs::COLORSPACE_COUNT;i++){
+        splitSpaces[i]=cs::createColorspace(i);
+    }
+
+    //same colors than the sparse color space mesh
+    sparseCloud.reserve(32*32*32);
+    sparseCloud.resize(32*32*32);
+    size_t n=0;
+    for(int r=0;r<256;r+=8) {
+        for(int g=0;g<256;g+=8){
+            for(int b=0;b<256;b+=8){
+                sparseCloud.keys()[n]=cs::DenseColorCounter::pack(r,g,b);
+                sparseCloud.counts()[n]=1;
+                n++;
+            }
+        }
+    }
 
+    //coordinates of the sparse colors in all the color spaces, in one parallel
+    //pass : changing color space is then a table lookup
+    float* c1[cs::COLORSPACE_COUNT];
+    float* c2[cs::COLORSPACE_COUNT];
+    float* c3[cs::COLORSPACE_COUNT];
+    for(int i=0;i<cs::COLORSPACE_COUNT;i++){
+        sparseCoordinates[i].resize(3*n);
+        c1[i]=sparseCoordinates[i].data();
+        c2[i]=c1[i]+n;
+        c3[i]=c2[i]+n;
+    }
+    cs::MultiTarget<float> target={splitSpaces,size_t(cs::COLORSPACE_COUNT),c1,c2,c3};
+    cs::convertPackedMulti(target,sparseCloud.keys(),n,true);
 }
 
 ColorspaceDisplayer::~ColorspaceDisplayer(){
+    stopConversion();
+    if(rangesSweep.valid()){
+        sweepToken.cancel();
+        rangesSweep.wait();
+    }
+    delete conversionSpace;
     delete currentColorSpace;
+    for(int i=0;i<cs::COLORSPACE_COUNT;i++){
+        delete splitSpaces[i];
+    }
 
 }
 
@@ -35,94 +157,451 @@ void ColorspaceDisplayer::setup(){
 
     generateSparseColorSpace();
     createHelpGui();
+    createFilterGui();
 
-    targetLocation=ofVec3f(ofGetWidth()/2.f,ofGetHeight()/2.f,-ofGetWidth()/2);
+    ofDirectory::createDirectory("cache",true,true);
+    cache.setDirectory(ofToDataPath("cache",true));
 
+    targetLocation=CUBE_CENTER;
 
+    if(!renderJobs.empty()){
+        runRenderJobs();
+    }
 }
 
-ofVec3f ColorspaceDisplayer::getCoordinates(ofColor color){
+void ColorspaceDisplayer::generateSparseColorSpace(){
+    ScopedTimer timer(profiler,"mesh");
+    targetLocation=CUBE_CENTER;
+    pickGridDirty=true;
+    size_t n=sparseCloud.size();
+    if(colorspace.getNumVertices()!=6*n){
+        //colors never change, only positions
+        colorspace.clear();
+        colorspace.setMode(OF_PRIMITIVE_TRIANGLES);
+        colorspace.getVertices().resize(6*n);
+        vector<ofFloatColor>& colors=colorspace.getColors();
+        colors.resize(6*n);
+        for(size_t i=0;i<n;i++){
+            ofFloatColor color=ofColor::fromHex(sparseCloud.keys()[i]);
+            for(int v=0;v<6;v++){
+                colors[6*i+v]=color;
+            }
+        }
+    }
 
-    ofVec3f pos;
-    currentColorSpace->convertFromRGB(color.r,color.g,color.b);
-    pos=ofVec3f(currentColorSpace->getNormalizedC1(),currentColorSpace->getNormalizedC2(),currentColorSpace->getNormalizedC3());
-    pos.z= ofMap(pos.z,0,1,-ofGetWidth(),0);
-    return pos;
+    //a square (two triangles) by color, around its precomputed coordinates
+    const float* c1=sparseCoordinates[colorspaceIndex].data();
+    const float* c2=c1+n;
+    const float* c3=c2+n;
+    vector<ofVec3f>& vertices=colorspace.getVertices();
+    for(size_t i=0;i<n;i++){
+        ofVec3f* square=&vertices[6*i];
+        square[0].set(c1[i]-SQUARE_SIZE,c2[i]-SQUARE_SIZE,c3[i]);
+        square[1].set(c1[i]+SQUARE_SIZE,c2[i]-SQUARE_SIZE,c3[i]);
+        square[2].set(c1[i]+SQUARE_SIZE,c2[i]+SQUARE_SIZE,c3[i]);
+        square[3].set(c1[i]-SQUARE_SIZE,c2[i]-SQUARE_SIZE,c3[i]);
+        square[4].set(c1[i]-SQUARE_SIZE,c2[i]+SQUARE_SIZE,c3[i]);
+        square[5].set(c1[i]+SQUARE_SIZE,c2[i]+SQUARE_SIZE,c3[i]);
+    }
 }
 
-void ColorspaceDisplayer::generateSparseColorSpace(){
-    targetLocation=ofVec3f(ofGetWidth()/2.f,ofGetHeight()/2.f,-ofGetWidth()/2);
-    colorspace.clear();
-    colorspace.setMode(OF_PRIMITIVE_TRIANGLES);
-    for(int r=0;r<256;r+=8) {
-        for(int g=0;g<256;g+=8){
-            for(int b=0;b<256;b+=8){
-                ofColor color=ofColor(r,g,b);
-                ofVec3f pos=getCoordinates(color);
-
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()-5,pos.y*ofGetHeight()-5,pos.z));
-                colorspace.addColor(color);
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()+5,pos.y*ofGetHeight()-5,pos.z));
-                colorspace.addColor(color);
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()+5,pos.y*ofGetHeight()+5,pos.z));
-                colorspace.addColor(color);
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()-5,pos.y*ofGetHeight()-5,pos.z));
-                colorspace.addColor(color);
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()-5,pos.y*ofGetHeight()+5,pos.z));
-                colorspace.addColor(color);
-                colorspace.addVertex(ofVec3f(pos.x*ofGetWidth()+5,pos.y*ofGetHeight()+5,pos.z));
-                colorspace.addColor(color);
-            }
+bool ColorspaceDisplayer::isHighDepthImage(string path){
+    string ext=ofToLower(ofFilePath::getFileExt(path));
+    return ext=="tif" || ext=="tiff" || ext=="exr" || ext=="hdr";
+}
+
+bool ColorspaceDisplayer::extractHighDepthImageColors(string path){
+    ofShortPixels pixels;
+    string ext=ofToLower(ofFilePath::getFileExt(path));
+    ScopedTimer decodeTimer(profiler,"decode");
+    if(ext=="exr" || ext=="hdr"){
+        ofFloatPixels floatPixels;
+        if(!ofLoadImage(floatPixels,path)){
+            return false;
+        }
+        //quantize to 16 bits, values out of [0;1] are clamped
+        pixels.allocate(floatPixels.getWidth(),floatPixels.getHeight(),floatPixels.getNumChannels());
+        const float* src=floatPixels.getData();
+        unsigned short* dst=pixels.getData();
+        size_t n=size_t(floatPixels.getWidth())*floatPixels.getHeight()*floatPixels.getNumChannels();
+        for(size_t i=0;i<n;i++){
+            dst[i]=(unsigned short)(ofClamp(src[i],0.f,1.f)*65535.f+0.5f);
         }
+    }else if(!ofLoadImage(pixels,path)){
+        return false;
     }
+    decodeTimer.stop();
 
+    ScopedTimer timer(profiler,"dedup");
+    cs::SparseColorCounter counter;
+    counter.addPixels(pixels.getData(),size_t(pixels.getWidth())*pixels.getHeight(),pixels.getNumChannels());
+
+    vector<unsigned int> occurences;
+    counter.getColors(highDepthColors,occurences);
+
+    //keys are only used to display colors : 16 bits colors are rounded to 8 bits
+    cloud.reserve(counter.size());
+    cloud.resize(counter.size());
+    for(size_t i=0;i<counter.size();i++){
+        const unsigned short* c=&highDepthColors[3*i];
+        cloud.keys()[i]=cs::DenseColorCounter::pack((c[0]+128)/257,(c[1]+128)/257,(c[2]+128)/257);
+        cloud.counts()[i]=occurences[i];
+    }
+    return true;
 }
 
-void ColorspaceDisplayer::extractImageColors(string path){
+bool ColorspaceDisplayer::extractLowDepthImageColors(string path){
+    viewPath=path;
+    if(MappedImage::isMappable(path)){
+        //raw pixels are indexed straight from the mapped file, without decoding nor copy
+        MappedImage mapped;
+        bool opened;
+        {
+            ScopedTimer timer(profiler,"decode");
+            opened=mapped.open(path);
+        }
+        if(opened){
+            indexImage(mapped.data(),mapped.getWidth(),mapped.getHeight(),3);
+            imageIndex.getColors(cloud);
+            imageIndex.clear();
+            return true;
+        }
+        //not a supported raw image (16 bits ppm...) : decode it
+    }
 
-    ofImage im;
-    if(im.load(path)){
-        colorspace.clear();
-        colorspace.setMode(OF_PRIMITIVE_POINTS);
+    ofPixels pixels;
+    {
+        ScopedTimer timer(profiler,"decode");
+        if(!ofLoadImage(pixels,path)){
+            return false;
+        }
+    }
+    indexImage(pixels.getData(),pixels.getWidth(),pixels.getHeight(),pixels.getNumChannels());
+    imageIndex.getColors(cloud);
+    imageIndex.clear();
+    return true;
+}
 
-        set<int> colors;
-        for(int y=0;y<im.getHeight();y++){
-            for(int x=0;x<im.getWidth();x++){
-                ofColor c=im.getColor(x,y);
-                colors.insert(c.getHex());
-            }
+void ColorspaceDisplayer::extractImageColors(string path){
+    cancelConversion();
+    ScopedTimer timer(profiler,"load image");
+    highDepthColors.clear();
+    displayColors.clear();
+    clearBrush();
+    viewIds.clear();
+    viewPath.clear();
+
+    //previously analyzed image : colors and coordinates are read from the cache
+    uint64_t hash=ColorCloudCache::hashFile(path);
+    if(hash!=0 && cache.open(hash) && cache.copyColors(cloud)){
+        convertImageColors();
+        uploadCloud();
+        if(showImageView){
+            loadImageView();
         }
+        return;
+    }
+    cache.close();
+
+    bool extracted;
+    if(isHighDepthImage(path)){
+        //no image view
+        viewPath=path;
+        extracted=extractHighDepthImageColors(path);
+    }else{
+        extracted=extractLowDepthImageColors(path);
+    }
+    if(!extracted){
+        return;
+    }
 
-        double xTarget=0;
-        double yTarget=0;
-        double zTarget=0;
-        for(auto it=colors.begin();it!=colors.end();it++){
-            ofColor color=ofColor::fromHex(*it);
-            ofVec3f pos= getCoordinates(color);
-            xTarget+=(pos.x*ofGetWidth());
-            yTarget+=(pos.y*ofGetHeight());
-            zTarget+=pos.z;
+    convertImageColors();
+    uploadCloud();
 
-            targetLocation+=pos;
-            colorspace.addVertex(ofVec3f(pos.x*ofGetWidth(),pos.y*ofGetHeight(),pos.z));
+    if(hash!=0 && !cache.save(hash,cloud,highDepthColors.empty() ? NULL : highDepthColors.data())){
+        ofLogWarning("ColorspaceDisplayer","can't write colors cache of "+path);
+    }
+}
 
-            colorspace.addColor(color);
+void ColorspaceDisplayer::compareImages(const vector<string>& paths){
+    cancelConversion();
+    //filled aside : the current comparison is kept if no image can be read
+    cs::GamutComparison sources;
+    sources.setSourceCount(paths.size());
+    vector<char> loaded(paths.size(),0);
+    //one bitset by image, filled in parallel
+    cs::parallelFor(0,paths.size(),[&](size_t i){
+        cs::ColorBitset& source=sources.getSource(i);
+        MappedImage mapped;
+        if(MappedImage::isMappable(paths[i]) && mapped.open(paths[i])){
+            source.addPixels(mapped.data(),mapped.getPixelCount(),3);
+            loaded[i]=1;
+            return;
+        }
+        ofPixels pixels;
+        if(ofLoadImage(pixels,paths[i])){
+            source.addPixels(pixels.getData(),size_t(pixels.getWidth())*pixels.getHeight(),pixels.getNumChannels());
+            loaded[i]=1;
+        }
+    });
+    //an unreadable image is left out, instead of being compared as an empty one
+    for(size_t i=0;i<paths.size();i++){
+        if(!loaded[i]){
+            ofLogWarning("ColorspaceDisplayer","can't read "+paths[i]+", left out of the comparison");
         }
-        xTarget/=double(colors.size());
-        yTarget/=double(colors.size());
-        zTarget/=double(colors.size());
-        targetLocation.set(xTarget,yTarget,zTarget);
     }
+    for(size_t i=paths.size();i>0;i--){
+        if(!loaded[i-1]){
+            sources.removeSource(i-1);
+        }
+    }
+    if(sources.getSourceCount()==0){
+        return;
+    }
+    swap(comparison,sources);
+    mode=COMPARISON;
+    computeComparison();
+}
+
+void ColorspaceDisplayer::computeComparison(){
+    //the background conversion reads the colors replaced here
+    cancelConversion();
+    //compared colors are not the ones of the cached image
+    cache.close();
+    highDepthColors.clear();
+    clearBrush();
+
+    vector<uint32_t> owners;
+    comparison.compute(comparisonOperation,cloud,owners);
+    convertImageColors();
 
+    displayColors.clear();
+    if(comparisonOperation==cs::GamutComparison::INTERSECTION){
+        uploadCloud();
+        return;
+    }
+    displayColors.resize(owners.size());
+    for(size_t i=0;i<owners.size();i++){
+        displayColors[i]= owners[i]==cs::GamutComparison::SHARED ? 0xffffff : getSourceColor(owners[i]);
+    }
+    uploadCloud(displayColors.data());
+}
 
+uint32_t ColorspaceDisplayer::getSourceColor(size_t source){
+    //golden ratio hues : neighbour sources get distant colors
+    float hue=fmod(source*0.618034f,1.f);
+    return ofColor::fromHsb(hue*255.f,200,255).getHex();
+}
+
+void ColorspaceDisplayer::uploadCloud(const uint32_t* colors){
+    ScopedTimer timer(profiler,"upload");
+    resetPicking();
+    volumeDirty=true;
+    if(gpuConversion){
+        gpuRenderer.upload(cloud.keys(),colors,cloud.size());
+    }else{
+        cloudRenderer.upload(cloud,colors);
+    }
+    splitDirty=true;
+}
+
+void ColorspaceDisplayer::measureGamut(){
+    ScopedTimer timer(profiler,"gamut");
+    uint64_t start=ofGetElapsedTimeMillis();
+    hull.compute(cloud.c1(),cloud.c2(),cloud.c3(),cloud.size());
+    voxelVolume=cs::voxelOccupancy(cloud.c1(),cloud.c2(),cloud.c3(),cloud.size());
+    gamutTime=ofGetElapsedTimeMillis()-start;
+
+    fillHullMesh(hull,hullMesh);
+}
+
+void ColorspaceDisplayer::fillHullMesh(const cs::ConvexHull& hull, ofMesh& mesh){
+    mesh.clear();
+    mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+    const vector<cs::Point3>& vertices=hull.getVertices();
+    for(size_t i=0;i<vertices.size();i++){
+        mesh.addVertex(ofVec3f(vertices[i].x,vertices[i].y,vertices[i].z));
+    }
+    const vector<uint32_t>& triangles=hull.getTriangles();
+    for(size_t i=0;i<triangles.size();i++){
+        mesh.addIndex(triangles[i]);
+    }
+}
+
+void ColorspaceDisplayer::convertImageColors(){
+    //the background conversion reads the colors this one may replace
+    cancelConversion();
+    //fitted ranges of the previous colors would clamp these ones
+    applyRanges(*currentColorSpace,colorspaceIndex);
+    if(gpuConversion){
+        targetLocation=CUBE_CENTER;
+        return;
+    }
+    ScopedTimer convertTimer(profiler,"convert");
+    convertColors(*currentColorSpace,rangeMode,cloud.c1(),cloud.c2(),cloud.c3(),channelStats);
+    convertTimer.stop();
+    useConvertedColors();
+}
+
+void ColorspaceDisplayer::convertColors(cs::ColorspaceInterface& space, RANGE_MODE ranges, float* c1, float* c2, float* c3,
+                                        cs::ChannelStats& stats){
+    size_t n=cloud.size();
+    //channel statistics are computed on each block of colors just converted, still in cache
+    //cached coordinates are clamped to the default ranges
+    if(ranges==DEFAULT_RANGES && cache.copyCoordinates(space,c1,c2,c3,n)){
+        //coordinates already computed when the image was first analyzed
+        cs::computeChannelStats(c1,c2,c3,cloud.counts(),n,stats);
+    }else if(highDepthColors.empty()){
+        cs::convertPackedWithStats(space,cloud.keys(),cloud.counts(),n,c1,c2,c3,stats);
+    }else{
+        //buffer is validated once, not per color
+        cs::convertBufferWithStats(space,highDepthColors.data(),cloud.counts(),n,c1,c2,c3,stats);
+    }
+    if(ranges==FITTED_RANGES && n>0){
+        //minimum and maximum of the colors are already reduced in the statistics
+        double low[3];
+        double high[3];
+        double fromScale[3];
+        double fromOffset[3];
+        double toScale[3];
+        double toOffset[3];
+        cs::fitRanges(space,stats,low,high);
+        space.getNormalization(fromScale,fromOffset);
+        space.setChannelRanges(low,high);
+        space.getNormalization(toScale,toOffset);
+        cs::renormalize(c1,c2,c3,n,fromScale,fromOffset,toScale,toOffset);
+        cs::computeChannelStats(c1,c2,c3,cloud.counts(),n,stats);
+    }
+}
+
+void ColorspaceDisplayer::startConversion(int index, bool morph){
+    //a previous switch not shown yet is replaced by this one
+    stopConversion();
+
+    //the main thread keeps showing and describing colors with currentColorSpace
+    delete conversionSpace;
+    conversionSpace=cs::createColorspace(index);
+    applyRanges(*conversionSpace,index);
+    conversionIndex=index;
+    conversionMorph=morph;
+    convertedCoordinates.resize(3*cloud.size());
+
+    conversionToken=cs::CancellationToken();
+    cs::CancellationToken token=conversionToken;
+    cs::ColorspaceInterface* space=conversionSpace;
+    RANGE_MODE ranges=rangeMode;
+    shared_ptr<packaged_task<void()> > task=make_shared<packaged_task<void()> >([this,token,space,ranges](){
+        cs::CancellationScope scope(token);
+        size_t n=cloud.size();
+        uint64_t start=Profiler::now();
+        float* c1=convertedCoordinates.data();
+        convertColors(*space,ranges,c1,c1+n,c1+2*n,convertedStats);
+        conversionStart=start;
+        conversionTime=Profiler::now()-start;
+    });
+    conversion=task->get_future();
+    threadPool.submit([task](){
+        (*task)();
+    });
+}
+
+void ColorspaceDisplayer::stopConversion(){
+    if(!conversion.valid()){
+        return;
+    }
+    //blocks not yet converted are skipped
+    conversionToken.cancel();
+    conversion.wait();
+    conversion=future<void>();
+}
+
+void ColorspaceDisplayer::cancelConversion(){
+    bool running=conversion.valid();
+    stopConversion();
+    //the color space switch is kept, without its colors
+    if(running && conversionIndex!=colorspaceIndex){
+        setColorspace(conversionIndex);
+    }
+}
+
+void ColorspaceDisplayer::updateConversion(){
+    if(!conversion.valid() || conversion.wait_for(chrono::seconds(0))!=future_status::ready){
+        return;
+    }
+    try{
+        conversion.get();
+    }catch(const exception& e){
+        ofLogWarning("ColorspaceDisplayer",string("conversion failed: ")+e.what());
+        return;
+    }
+    profiler.record("convert",conversionStart,conversionTime);
+    //colors didn't change since the start (they cancel it), the display may have
+    if((mode!=IMAGE && mode!=COMPARISON) || gpuConversion || convertedCoordinates.size()!=3*cloud.size()){
+        setColorspace(conversionIndex);
+        return;
+    }
+    //the morph starts from the coordinates still drawn
+    if(conversionMorph){
+        startMorph();
+    }
+    size_t n=cloud.size();
+    copy(convertedCoordinates.begin(),convertedCoordinates.begin()+n,cloud.c1());
+    copy(convertedCoordinates.begin()+n,convertedCoordinates.begin()+2*n,cloud.c2());
+    copy(convertedCoordinates.begin()+2*n,convertedCoordinates.end(),cloud.c3());
+    channelStats=convertedStats;
+    //the converted colors are shown in their color space, with its fitted ranges
+    swap(currentColorSpace,conversionSpace);
+    colorspaceIndex=conversionIndex;
+    updateAxisNames();
+
+    useConvertedColors();
+    ScopedTimer timer(profiler,"upload");
+    cloudRenderer.uploadCoordinates(cloud);
+    splitDirty=true;
+}
+
+void ColorspaceDisplayer::useConvertedColors(){
+    pickGridDirty=true;
+    volumeDirty=true;
+    measureGamut();
+    if(cloud.empty()){
+        return;
+    }
+    //camera looks at the mean position of the colors
+    double xTarget=0;
+    double yTarget=0;
+    double zTarget=0;
+    for(size_t i=0;i<cloud.size();i++){
+        xTarget+=cloud.c1()[i];
+        yTarget+=cloud.c2()[i];
+        zTarget+=cloud.c3()[i];
+    }
+    xTarget/=double(cloud.size());
+    yTarget/=double(cloud.size());
+    zTarget/=double(cloud.size());
+    targetLocation.set(xTarget,yTarget,zTarget);
 }
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::update(){
-
+    //the camera doesn't follow the mouse on the panels, nor while brushing
+    if(showImageView || isOverPanel(mousePosition.x,mousePosition.y)){
+        cam.disableMouseInput();
+    }else{
+        cam.enableMouseInput();
+    }
+    updateFilter();
+    updateRangesSweep();
+    updateConversion();
 }
 //--------------------------------------------------------------
 void ColorspaceDisplayer::draw(){
+    //time between two frames
+    uint64_t frameStart=Profiler::now();
+    if(lastFrameStart!=0){
+        profiler.record("frame",lastFrameStart,frameStart-lastFrameStart);
+    }
+    lastFrameStart=frameStart;
 
     if(showHelp){
         helpPanel.draw();
@@ -131,28 +610,830 @@ void ColorspaceDisplayer::draw(){
 
     //draw color space name
     string title="color space: ";
-    ofDrawBitmapString(title.append(currentColorSpace->getName()),10,10,0);
+    title.append(currentColorSpace->getName());
+    if(mode==COMPARISON){
+        title+=" - "+cs::GamutComparison::getOperationName(comparisonOperation)+" of "+
+                ofToString(comparison.getSourceCount())+" images";
+    }
+    if(mode==IMAGE || mode==COMPARISON){
+        title+=" - ranges: "+string(RANGE_MODE_NAMES[rangeMode]);
+    }
+    if(conversion.valid()){
+        title+=" (converting...)";
+    }
+    if(rangesSweep.valid() && (mode==IMAGE || mode==COMPARISON)){
+        title+=" (sweeping exact ranges...)";
+    }
+    ofDrawBitmapString(title,10,10,0);
+    if((mode==IMAGE || mode==COMPARISON) && gpuConversion){
+        ofDrawBitmapString(volumeRendering ? "gamut: not measured, no volume with gpu conversion" :
+                                             "gamut: not measured with gpu conversion",10,25,0);
+    }else if(mode==IMAGE || mode==COMPARISON){
+        //volumes are given as a part of the normalized color space
+        ofDrawBitmapString("gamut: hull "+ofToString(hull.getVolume()*100.,2)+"% - voxels "+
+                           ofToString(voxelVolume*100.,2)+"% ("+ofToString(gamutTime)+" ms)",10,25,0);
+    }
+
+    if(showProfiler){
+        drawProfiler();
+    }
+    if(showFilter){
+        filterPanel.draw();
+    }
+
+    if(splitLayout>1){
+        drawSplitView();
+        return;
+    }
 
     //set cam target
     ofNode target;
-    target.setPosition(targetLocation);
+    target.setPosition(toWindowSpace(targetLocation));
     cam.setTarget(target);
 
     cam.begin();
-    //draw axis
-    ofSetLineWidth(3);
-    ofSetColor(0,0,128);
+    drawScene();
+    cam.end();
 
-    if(showAxis){
+    if(hoveredColor>=0){
+        ofDrawBitmapStringHighlight(describeColor(hoveredColor),mousePosition.x+15,mousePosition.y+5);
+    }
+    if(pickedColor>=0){
+        ofDrawBitmapStringHighlight("picked: "+describeColor(pickedColor),10,ofGetHeight()-15);
+    }
+    if(showImageView && mode==IMAGE){
+        drawImageView();
+    }
+    if(showStats && (mode==IMAGE || mode==COMPARISON)){
+        drawStats();
+    }
+}
+
+void ColorspaceDisplayer::startMorph(){
+    //the start is the blend drawn now, so a retargeted morph doesn't jump
+    float morph=getMorph();
+    if(gpuConversion){
+        gpuRenderer.startMorph(*currentColorSpace,colorspaceIndex,morph);
+    }else{
+        cloudRenderer.startMorph(cloud.c1(),cloud.c2(),cloud.c3(),morph);
+    }
+    morphStartFrame=ofGetFrameNum();
+}
+
+float ColorspaceDisplayer::getMorph(){
+    if(!morphEnabled){
+        return 1.f;
+    }
+    float t=min(1.f,(ofGetFrameNum()-morphStartFrame)/float(MORPH_FRAMES));
+    //smoothstep : colors start and stop slowly
+    return t*t*(3.f-2.f*t);
+}
+
+int ColorspaceDisplayer::getViewColorspace(int view){
+    return (colorspaceIndex+view)%cs::COLORSPACE_COUNT;
+}
+
+void ColorspaceDisplayer::updateSplitView(){
+    const cs::ColorCloud& colors= mode==SPARSE_CS ? sparseCloud : cloud;
+    size_t n=colors.size();
+    cs::ColorspaceInterface* spaces[cs::COLORSPACE_COUNT];
+    float* c1[cs::COLORSPACE_COUNT];
+    float* c2[cs::COLORSPACE_COUNT];
+    float* c3[cs::COLORSPACE_COUNT];
+    for(int v=0;v<splitLayout;v++){
+        //sparse colors are already converted
+        vector<float>& coordinates= mode==SPARSE_CS ? sparseCoordinates[getViewColorspace(v)] : splitCoordinates[v];
+        spaces[v]=splitSpaces[getViewColorspace(v)];
+        coordinates.resize(3*n);
+        c1[v]=coordinates.data();
+        c2[v]=c1[v]+n;
+        c3[v]=c2[v]+n;
+    }
+
+    if(mode!=SPARSE_CS){
+        //colors are read once for all the viewports
+        ScopedTimer timer(profiler,"convert");
+        cs::MultiTarget<float> target={spaces,size_t(splitLayout),c1,c2,c3};
+        if(!highDepthColors.empty()){
+            cs::convertBufferMulti(target,highDepthColors.data(),n,true);
+        }else{
+            cs::convertPackedMulti(target,colors.keys(),n,true);
+        }
+    }
+
+    ScopedTimer timer(profiler,"upload");
+    const uint32_t* keys=colors.keys();
+    if(mode!=SPARSE_CS && !brushColors.empty()){
+        keys=brushColors.data();
+    }else if(mode!=SPARSE_CS && !displayColors.empty()){
+        keys=displayColors.data();
+    }
+    for(int v=0;v<splitLayout;v++){
+        splitRenderers[v].upload(keys,c1[v],c2[v],c3[v],n);
+    }
+    splitDirty=false;
+    splitHullsDirty=true;
+}
+
+void ColorspaceDisplayer::updateSplitHulls(){
+    ScopedTimer timer(profiler,"gamut");
+    cs::ConvexHull viewHull;
+    for(int v=0;v<splitLayout;v++){
+        size_t n=cloud.size();
+        const float* c1=splitCoordinates[v].data();
+        viewHull.compute(c1,c1+n,c1+2*n,n);
+        fillHullMesh(viewHull,splitHullMeshes[v]);
+    }
+    splitHullsDirty=false;
+}
+
+void ColorspaceDisplayer::drawSplitView(){
+    //with GPU conversion, each viewport draws the same colors with its own color space
+    bool gpuViews=gpuConversion && mode!=SPARSE_CS;
+    if(splitDirty && !gpuViews){
+        updateSplitView();
+    }
+    //all the color spaces are normalized in the same cube : the camera looks at its center
+    ofNode target;
+    target.setPosition(toWindowSpace(CUBE_CENTER));
+    cam.setTarget(target);
+    //hulls of sparse colors would be the cube, GPU converted colors have no coordinates
+    bool viewHulls=showHull && !gpuViews && (mode==IMAGE || mode==COMPARISON);
+    if(viewHulls && splitHullsDirty){
+        updateSplitHulls();
+    }
+    //the shared camera is never begun on a viewport, it would then be moved
+    //from this viewport only
+    ofCamera viewCam;
+    viewCam.setFov(cam.getFov());
+    viewCam.setNearClip(cam.getNearClip());
+    viewCam.setFarClip(cam.getFarClip());
+    viewCam.setTransformMatrix(cam.getGlobalTransformMatrix());
+
+    int columns=splitLayout/2;
+    float viewWidth=ofGetWidth()/float(columns);
+    float viewHeight=ofGetHeight()/2.f;
+    ScopedTimer drawTimer(profiler,"draw");
+    for(int v=0;v<splitLayout;v++){
+        ofRectangle viewport((v%columns)*viewWidth,(v/columns)*viewHeight,viewWidth,viewHeight);
+        viewCam.begin(viewport);
+        if(showAxis){
+            drawAxis(CUBE_CENTER);
+        }
         ofPushMatrix();
-        ofTranslate(targetLocation.x,targetLocation.y,targetLocation.z);
-        ofDrawAxis(targetLocation.x);
+        applySceneTransform();
+        if(gpuViews){
+            gpuRenderer.draw(*splitSpaces[getViewColorspace(v)],getViewColorspace(v));
+        }else{
+            splitRenderers[v].draw();
+        }
+        if(viewHulls){
+            ofSetLineWidth(1);
+            ofSetColor(255);
+            splitHullMeshes[v].drawWireframe();
+        }
         ofPopMatrix();
+        viewCam.end();
+
+        ofSetLineWidth(1);
+        ofSetColor(80);
+        ofNoFill();
+        ofDrawRectangle(viewport);
+        ofFill();
+        ofSetColor(255);
+        ofDrawBitmapString(splitSpaces[getViewColorspace(v)]->getName(),viewport.x+10,viewport.y+viewport.height-10,0);
+    }
+}
+
+void ColorspaceDisplayer::drawScene(){
+    if(showAxis){
+        drawAxis(targetLocation);
     }
 
 
-    colorspace.draw();
-    cam.end();
+    ScopedTimer drawTimer(profiler,"draw");
+    ofPushMatrix();
+    applySceneTransform();
+    if((mode==IMAGE || mode==COMPARISON) && gpuConversion){
+        gpuRenderer.draw(*currentColorSpace,colorspaceIndex,getMorph());
+    }else if((mode==IMAGE || mode==COMPARISON) && volumeRendering){
+        if(volumeDirty){
+            updateVolume();
+        }
+        volumeRenderer.draw(fromWindowSpace(cam.getGlobalPosition()));
+        if(showHull){
+            ofSetLineWidth(1);
+            ofSetColor(255);
+            hullMesh.drawWireframe();
+        }
+    }else if(mode==IMAGE || mode==COMPARISON){
+        cloudRenderer.draw(getMorph());
+        if(showHull){
+            ofSetLineWidth(1);
+            ofSetColor(255);
+            hullMesh.drawWireframe();
+        }
+    }else{
+        colorspace.draw();
+    }
+    drawPickedColors();
+    ofPopMatrix();
+}
+
+void ColorspaceDisplayer::drawAxis(const ofVec3f& origin){
+    ofSetLineWidth(3);
+    ofSetColor(0,0,128);
+    ofVec3f position=toWindowSpace(origin);
+    ofPushMatrix();
+    ofTranslate(position.x,position.y,position.z);
+    ofDrawAxis(position.x);
+    ofPopMatrix();
+}
+
+void ColorspaceDisplayer::applySceneTransform(){
+    ofTranslate(0,0,-ofGetWidth());
+    ofScale(ofGetWidth(),ofGetHeight(),ofGetWidth());
+}
+
+ofVec3f ColorspaceDisplayer::toWindowSpace(const ofVec3f& position){
+    return ofVec3f(position.x*ofGetWidth(),position.y*ofGetHeight(),position.z*ofGetWidth()-ofGetWidth());
+}
+
+ofVec3f ColorspaceDisplayer::fromWindowSpace(const ofVec3f& position){
+    return ofVec3f(position.x/ofGetWidth(),position.y/ofGetHeight(),(position.z+ofGetWidth())/ofGetWidth());
+}
+
+size_t ColorspaceDisplayer::getDisplayedCoordinates(const float*& c1, const float*& c2, const float*& c3){
+    if(mode==SPARSE_CS){
+        size_t n=sparseCloud.size();
+        c1=sparseCoordinates[colorspaceIndex].data();
+        c2=c1+n;
+        c3=c2+n;
+        return n;
+    }
+    c1=cloud.c1();
+    c2=cloud.c2();
+    c3=cloud.c3();
+    return cloud.size();
+}
+
+long ColorspaceDisplayer::pickColor(int x, int y){
+    if(splitLayout>1 || (gpuConversion && mode!=SPARSE_CS)){
+        return -1;
+    }
+    const float* c1;
+    const float* c2;
+    const float* c3;
+    size_t n=getDisplayedCoordinates(c1,c2,c3);
+    if(pickGridDirty){
+        ScopedTimer timer(profiler,"pick grid");
+        pickGrid.build(c1,c2,c3,n);
+        pickGridDirty=false;
+    }
+    //mouse ray, from the near plane to the far plane, in the normalized color space
+    ofVec3f nearPoint=fromWindowSpace(cam.screenToWorld(ofVec3f(x,y,-1)));
+    ofVec3f farPoint=fromWindowSpace(cam.screenToWorld(ofVec3f(x,y,1)));
+    float origin[3]={nearPoint.x,nearPoint.y,nearPoint.z};
+    float direction[3]={farPoint.x-nearPoint.x,farPoint.y-nearPoint.y,farPoint.z-nearPoint.z};
+    if(direction[0]==0 && direction[1]==0 && direction[2]==0){
+        return -1;
+    }
+    ScopedTimer timer(profiler,"pick");
+    //hidden colors can't be picked
+    return pickGrid.pick(origin,direction,PICK_RADIUS,[&](uint32_t i){
+        return filter.accepts(c1[i],c2[i],c3[i]);
+    });
+}
+
+string ColorspaceDisplayer::describeColor(long index){
+    uint32_t key= mode==SPARSE_CS ? sparseCloud.keys()[index] : cloud.keys()[index];
+    string rgb;
+    if(mode!=SPARSE_CS && !highDepthColors.empty()){
+        const unsigned short* c=&highDepthColors[3*index];
+        rgb="rgb16 "+ofToString(c[0])+" "+ofToString(c[1])+" "+ofToString(c[2]);
+        currentColorSpace->convertScaledRGB(c[0]*255./65535.,c[1]*255./65535.,c[2]*255./65535.);
+    }else{
+        unsigned int red=(key>>16)&0xff;
+        unsigned int green=(key>>8)&0xff;
+        unsigned int blue=key&0xff;
+        rgb="rgb "+ofToString(red)+" "+ofToString(green)+" "+ofToString(blue);
+        currentColorSpace->convertFromRGB(red,green,blue);
+    }
+    string description=rgb+" - "+xAxisName+" "+ofToString(currentColorSpace->getC1(),3)+" "+
+            yAxisName+" "+ofToString(currentColorSpace->getC2(),3)+" "+zAxisName+" "+ofToString(currentColorSpace->getC3(),3);
+    if(mode!=SPARSE_CS){
+        description+=" - "+ofToString(cloud.counts()[index])+" pixels";
+    }
+    return description;
+}
+
+void ColorspaceDisplayer::drawPickedColors(){
+    const float* c1;
+    const float* c2;
+    const float* c3;
+    getDisplayedCoordinates(c1,c2,c3);
+    long colors[2]={hoveredColor,pickedColor};
+    ofPushStyle();
+    ofNoFill();
+    ofSetLineWidth(1);
+    //hovered color in white, picked color in yellow
+    for(int i=0;i<2;i++){
+        if(colors[i]>=0){
+            ofSetColor(255,255,i==0 ? 255 : 0);
+            ofDrawBox(c1[colors[i]],c2[colors[i]],c3[colors[i]],4*PICK_RADIUS,4*PICK_RADIUS,4*PICK_RADIUS);
+        }
+    }
+    ofPopStyle();
+}
+
+void ColorspaceDisplayer::resetPicking(){
+    hoveredColor=-1;
+    pickedColor=-1;
+    pickGridDirty=true;
+}
+
+void ColorspaceDisplayer::setImageView(bool show){
+    showImageView=show;
+    brushing=false;
+    if(show){
+        loadImageView();
+    }
+    if(!show && !brushSelection.empty() && mode==IMAGE){
+        clearBrush();
+        uploadCloud();
+    }
+}
+
+void ColorspaceDisplayer::indexImage(const unsigned char* data, size_t width, size_t height, size_t channels){
+    {
+        ScopedTimer timer(profiler,"dedup");
+        imageIndex.scan(data,width*height,channels);
+        imageIndex.buildIds();
+    }
+    buildImageView(data,width,height,channels);
+}
+
+void ColorspaceDisplayer::buildImageView(const unsigned char* data, size_t width, size_t height, size_t channels){
+    viewIds.clear();
+    //raw dumps are mapped as a single line : only images with rows are shown
+    if(height<=1 || imageIndex.getPixelCount()!=width*height){
+        return;
+    }
+    ScopedTimer timer(profiler,"image view");
+    //nearest pixel downsampling, of the pixels and of their ids
+    size_t step=(max(width,height)+IMAGE_VIEW_SIZE-1)/IMAGE_VIEW_SIZE;
+    size_t viewWidth=max<size_t>(1,width/step);
+    size_t viewHeight=max<size_t>(1,height/step);
+    viewPixels.allocate(viewWidth,viewHeight,3);
+    viewIds.resize(viewWidth*viewHeight);
+    unsigned char* view=viewPixels.getData();
+    const uint32_t* ids=imageIndex.getIds().data();
+    //gray images have a single value by pixel
+    size_t green= channels>=3 ? 1 : 0;
+    size_t blue= channels>=3 ? 2 : 0;
+    cs::parallelFor(0,viewHeight,[&](size_t y){
+        size_t row=y*step*width;
+        for(size_t x=0;x<viewWidth;x++){
+            size_t pixel=row+x*step;
+            const unsigned char* p=data+channels*pixel;
+            unsigned char* v=view+3*(y*viewWidth+x);
+            v[0]=p[0];
+            v[1]=p[green];
+            v[2]=p[blue];
+            viewIds[y*viewWidth+x]=ids[pixel];
+        }
+    });
+    viewTexture.allocate(viewPixels);
+    viewTexture.loadData(viewPixels);
+    viewMask.allocate(viewWidth,viewHeight,4);
+    viewMaskTexture.allocate(viewMask);
+}
+
+void ColorspaceDisplayer::loadImageView(){
+    if(viewPath==imPath || mode!=IMAGE){
+        return;
+    }
+    viewPath=imPath;
+    if(isHighDepthImage(imPath)){
+        return;
+    }
+    MappedImage mapped;
+    ofPixels pixels;
+    {
+        ScopedTimer timer(profiler,"decode");
+        if(!(MappedImage::isMappable(imPath) && mapped.open(imPath)) && !ofLoadImage(pixels,imPath)){
+            return;
+        }
+    }
+    if(mapped.data()!=NULL){
+        indexImage(mapped.data(),mapped.getWidth(),mapped.getHeight(),3);
+    }else{
+        indexImage(pixels.getData(),pixels.getWidth(),pixels.getHeight(),pixels.getNumChannels());
+    }
+    //cached colors are sorted by key too : ids are their indices
+    if(imageIndex.getColorCount()!=cloud.size()){
+        viewIds.clear();
+    }
+    imageIndex.clear();
+}
+
+ofRectangle ColorspaceDisplayer::getImageViewRect(){
+    //bottom right corner, a third of the window wide at most
+    float width=ofGetWidth()/3.f;
+    float height=ofGetHeight()/3.f;
+    if(viewPixels.getWidth()*height>viewPixels.getHeight()*width){
+        height=width*viewPixels.getHeight()/max<size_t>(1,viewPixels.getWidth());
+    }else{
+        width=height*viewPixels.getWidth()/max<size_t>(1,viewPixels.getHeight());
+    }
+    return ofRectangle(ofGetWidth()-width-10,ofGetHeight()-height-10,width,height);
+}
+
+void ColorspaceDisplayer::brushCloud(float x0, float y0, float x1, float y1){
+    if(gpuConversion || splitLayout>1 || cloud.empty()){
+        //coordinates are only on the GPU, or the views don't share a projection
+        return;
+    }
+    //projection of the normalized color space : scene transform, then the camera
+    float w=ofGetWidth();
+    float h=ofGetHeight();
+    ofMatrix4x4 projection=ofMatrix4x4::newScaleMatrix(w,h,w)*ofMatrix4x4::newTranslationMatrix(0,0,-w)*
+            cam.getModelViewProjectionMatrix();
+    //window y goes down, normalized device y goes up
+    float low[2]={2.f*min(x0,x1)/w-1.f,1.f-2.f*max(y0,y1)/h};
+    float high[2]={2.f*max(x0,x1)/w-1.f,1.f-2.f*min(y0,y1)/h};
+    brushSelection.resize(cloud.size());
+    {
+        ScopedTimer timer(profiler,"brush");
+        cs::selectProjected(cloud.c1(),cloud.c2(),cloud.c3(),cloud.size(),projection.getPtr(),low,high,brushSelection.data());
+        //hidden colors are not brushed
+        for(size_t i=0;i<cloud.size();i++){
+            if(brushSelection[i] && !filter.accepts(cloud.c1()[i],cloud.c2()[i],cloud.c3()[i])){
+                brushSelection[i]=0;
+            }
+        }
+    }
+    applyBrush();
+}
+
+void ColorspaceDisplayer::brushImage(float x0, float y0, float x1, float y1){
+    if(viewIds.empty()){
+        return;
+    }
+    //window to view pixels
+    ofRectangle rect=getImageViewRect();
+    float scale=viewPixels.getWidth()/rect.width;
+    size_t width=viewPixels.getWidth();
+    size_t height=viewPixels.getHeight();
+    size_t left=size_t(ofClamp((min(x0,x1)-rect.x)*scale,0,width));
+    size_t right=size_t(ofClamp((max(x0,x1)-rect.x)*scale,0,width));
+    size_t top=size_t(ofClamp((min(y0,y1)-rect.y)*scale,0,height));
+    size_t bottom=size_t(ofClamp((max(y0,y1)-rect.y)*scale,0,height));
+    brushSelection.assign(cloud.size(),0);
+    {
+        ScopedTimer timer(profiler,"brush");
+        cs::selectIdsInRect(viewIds.data(),width,left,top,right,bottom,brushSelection.data(),cloud.size());
+    }
+    applyBrush();
+}
+
+void ColorspaceDisplayer::applyBrush(){
+    ScopedTimer timer(profiler,"brush mask");
+    //selected colors keep their color, the others are dimmed
+    brushColors.resize(cloud.size());
+    brushedPixels=0;
+    //mask value of each color id
+    vector<uint32_t> maskValues(cloud.size(),MASK_DIM);
+    for(size_t i=0;i<cloud.size();i++){
+        uint32_t key=cloud.keys()[i];
+        if(brushSelection[i]){
+            brushColors[i]=key;
+            maskValues[i]=0;
+            brushedPixels+=cloud.counts()[i];
+        }else{
+            brushColors[i]=(key>>2) & 0x3f3f3f;
+        }
+    }
+    uploadCloud(brushColors.data());
+
+    if(!viewIds.empty()){
+        cs::remapIds(viewIds.data(),viewIds.size(),maskValues.data(),reinterpret_cast<uint32_t*>(viewMask.getData()));
+        viewMaskTexture.loadData(viewMask);
+    }
+}
+
+void ColorspaceDisplayer::clearBrush(){
+    brushSelection.clear();
+    brushColors.clear();
+    brushedPixels=0;
+}
+
+void ColorspaceDisplayer::drawImageView(){
+    if(viewIds.empty()){
+        ofDrawBitmapStringHighlight("image view: 8 bits images only",ofGetWidth()-250,ofGetHeight()-15);
+        return;
+    }
+    ofRectangle rect=getImageViewRect();
+    ofPushStyle();
+    ofSetColor(255);
+    viewTexture.draw(rect.x,rect.y,rect.width,rect.height);
+    if(!brushSelection.empty()){
+        ofEnableAlphaBlending();
+        viewMaskTexture.draw(rect.x,rect.y,rect.width,rect.height);
+        ofDrawBitmapStringHighlight(ofToString(brushedPixels)+" pixels selected",rect.x,rect.y-5);
+    }
+    if(brushing){
+        ofNoFill();
+        ofDrawRectangle(pressPosition.x,pressPosition.y,brushEnd.x-pressPosition.x,brushEnd.y-pressPosition.y);
+    }
+    ofPopStyle();
+}
+
+void ColorspaceDisplayer::drawProfiler(){
+    vector<string> stages=profiler.getStages();
+    int x=ofGetWidth()-340;
+    int y=10;
+    ofDrawBitmapString("stage          last   p50   p95 (ms)",x,y,0);
+    for(size_t i=0;i<stages.size();i++){
+        Profiler::Stats stats=profiler.getStats(stages[i]);
+        char line[128];
+        snprintf(line,sizeof(line),"%-12s %6.1f %5.1f %5.1f",stages[i].c_str(),stats.last,stats.p50,stats.p95);
+        y+=15;
+        ofDrawBitmapString(line,x,y,0);
+    }
+}
+
+void ColorspaceDisplayer::drawStats(){
+    const int histogramHeight=40;
+    const int rowHeight=histogramHeight+20;
+    int x=10;
+    int y=ofGetHeight()-30-3*rowHeight;
+    if(gpuConversion){
+        ofDrawBitmapStringHighlight("channel statistics need CPU conversion (u)",x,ofGetHeight()-30-histogramHeight);
+        return;
+    }
+    //statistics are computed on normalized values, shown in the units of the color space
+    double scale[3];
+    double offset[3];
+    currentColorSpace->getNormalization(scale,offset);
+    string names[3]={xAxisName,yAxisName,zAxisName};
+    ofPushStyle();
+    for(int c=0;c<3;c++){
+        int top=y+c*rowHeight;
+        ofFill();
+        ofSetColor(0,0,0,160);
+        ofDrawRectangle(x,top,cs::ChannelStats::BINS,histogramHeight);
+        double highest=channelStats.maxBin(c);
+        ofSetColor(200);
+        for(size_t b=0;b<cs::ChannelStats::BINS && highest>0;b++){
+            float h=float(channelStats.histogram[c][b]/highest)*histogramHeight;
+            ofDrawRectangle(x+b,top+histogramHeight-h,1,h);
+        }
+        double s=scale[c];
+        double o=offset[c];
+        char line[160];
+        snprintf(line,sizeof(line),"%s mean %.3g sd %.3g p5 %.3g p50 %.3g p95 %.3g min %.3g max %.3g",
+                 names[c].c_str(),(channelStats.mean(c)-o)/s,sqrt(channelStats.variance(c))/fabs(s),
+                 (channelStats.percentile(c,0.05)-o)/s,(channelStats.percentile(c,0.5)-o)/s,
+                 (channelStats.percentile(c,0.95)-o)/s,(channelStats.minimum[c]-o)/s,(channelStats.maximum[c]-o)/s);
+        ofSetColor(255);
+        ofDrawBitmapString(line,x,top+histogramHeight+13,0);
+    }
+    ofPopStyle();
+}
+
+void ColorspaceDisplayer::saveTrace(){
+    string path=ofToDataPath("trace_"+ofGetTimestampString()+".json",true);
+    if(profiler.saveTrace(path)){
+        ofLogNotice("ColorspaceDisplayer","trace saved in "+path);
+    }else{
+        ofLogWarning("ColorspaceDisplayer","can't write "+path);
+    }
+}
+
+void ColorspaceDisplayer::exportConvertedImage(){
+    if(imPath.empty()){
+        return;
+    }
+    ofFileDialogResult saveDialog= ofxSystemSaveDialog(ofFilePath::getBaseName(imPath)+"_"+currentColorSpace->getName()+".tif",
+                                                       "Save converted image (.tif : 16 bits, other : float channels)");
+    if(saveDialog.bSuccess && !convertImage(imPath,saveDialog.getPath())){
+        ofLogWarning("ColorspaceDisplayer","can't convert "+imPath+" to "+saveDialog.getPath());
+    }
+}
+
+/**
+ * @brief writeConvertedImage convert pixels and stream them to a new file
+ * @param space
+ * @param rgb interleaved red, green and blue values
+ * @param width
+ * @param height
+ * @param outputPath
+ * @param names channels names
+ * @return false if the output can't be written
+ */
+template<typename T>
+static bool writeConvertedImage(cs::ColorspaceInterface& space, const T* rgb, size_t width, size_t height,
+                                string outputPath, const string names[3]){
+    ConvertedImageWriter::Format format=ConvertedImageWriter::formatFromPath(outputPath);
+    ConvertedImageWriter writer;
+    if(!writer.open(outputPath,format,width,height,names)){
+        return false;
+    }
+    auto sink=[&](size_t first, size_t count, const float* c1, const float* c2, const float* c3){
+        return writer.write(c1,c2,c3,count);
+    };
+    //16 bits integers need normalized values, floats keep raw ones
+    bool converted=cs::convertPixels(space,rgb,width*height,format==ConvertedImageWriter::TIFF_16,sink);
+    return writer.close() && converted;
+}
+
+bool ColorspaceDisplayer::convertImage(string path, string outputPath){
+    string names[3]={xAxisName,yAxisName,zAxisName};
+    MappedImage mapped;
+    if(MappedImage::isMappable(path) && mapped.open(path)){
+        return writeConvertedImage(*currentColorSpace,mapped.data(),mapped.getWidth(),mapped.getHeight(),outputPath,names);
+    }
+
+    string ext=ofToLower(ofFilePath::getFileExt(path));
+    if(ext=="exr" || ext=="hdr"){
+        ofFloatPixels pixels;
+        if(!ofLoadImage(pixels,path)){
+            return false;
+        }
+        pixels.setImageType(OF_IMAGE_COLOR);
+        //values out of [0;1] are clamped, as when colors are extracted
+        float* data=pixels.getData();
+        size_t n=size_t(pixels.getWidth())*pixels.getHeight()*3;
+        for(size_t i=0;i<n;i++){
+            data[i]=ofClamp(data[i],0.f,1.f);
+        }
+        return writeConvertedImage(*currentColorSpace,pixels.getData(),pixels.getWidth(),pixels.getHeight(),outputPath,names);
+    }else if(isHighDepthImage(path)){
+        ofShortPixels pixels;
+        if(!ofLoadImage(pixels,path)){
+            return false;
+        }
+        pixels.setImageType(OF_IMAGE_COLOR);
+        return writeConvertedImage(*currentColorSpace,pixels.getData(),pixels.getWidth(),pixels.getHeight(),outputPath,names);
+    }
+    ofPixels pixels;
+    if(!ofLoadImage(pixels,path)){
+        return false;
+    }
+    pixels.setImageType(OF_IMAGE_COLOR);
+    return writeConvertedImage(*currentColorSpace,pixels.getData(),pixels.getWidth(),pixels.getHeight(),outputPath,names);
+}
+
+void ColorspaceDisplayer::setColorspace(int index){
+    stopConversion();
+    delete currentColorSpace;
+    currentColorSpace=cs::createColorspace(index);
+    colorspaceIndex=index;
+    updateAxisNames();
+    applyRanges(*currentColorSpace,colorspaceIndex);
+}
+
+void ColorspaceDisplayer::updateAxisNames(){
+    xAxisName=AXIS_NAMES[colorspaceIndex][0];
+    yAxisName=AXIS_NAMES[colorspaceIndex][1];
+    zAxisName=AXIS_NAMES[colorspaceIndex][2];
+    for(int c=0;c<3;c++){
+        rangeSliders[c][0].setName(string(AXIS_NAMES[colorspaceIndex][c])+" min");
+        rangeSliders[c][1].setName(string(AXIS_NAMES[colorspaceIndex][c])+" max");
+    }
+}
+
+void ColorspaceDisplayer::applyRanges(cs::ColorspaceInterface& space, int index){
+    if(rangeMode!=DEFAULT_RANGES && exactRangesKnown[index]){
+        space.setChannelRanges(exactLow[index],exactHigh[index]);
+        return;
+    }
+    //default ranges, until the exact ones are swept
+    space.setChannelRanges(defaultLow[index],defaultHigh[index]);
+    if(rangeMode!=DEFAULT_RANGES && mode!=SPARSE_CS){
+        sweepExactRanges(index);
+    }
+}
+
+void ColorspaceDisplayer::sweepExactRanges(int index){
+    //a color space still missing its ranges once the running sweep ends is swept next
+    if(rangesSweep.valid()){
+        return;
+    }
+    sweepIndex=index;
+    sweepToken=cs::CancellationToken();
+    cs::CancellationToken token=sweepToken;
+    shared_ptr<packaged_task<void()> > task=make_shared<packaged_task<void()> >([this,token,index](){
+        cs::CancellationScope scope(token);
+        uint64_t start=Profiler::now();
+        cs::ColorspaceInterface* space=cs::createColorspace(index);
+        cs::computeExactRanges(*space,sweptLow,sweptHigh);
+        delete space;
+        sweepStart=start;
+        sweepTime=Profiler::now()-start;
+    });
+    rangesSweep=task->get_future();
+    threadPool.submit([task](){
+        (*task)();
+    });
+}
+
+void ColorspaceDisplayer::updateRangesSweep(){
+    if(!rangesSweep.valid() || rangesSweep.wait_for(chrono::seconds(0))!=future_status::ready){
+        return;
+    }
+    try{
+        rangesSweep.get();
+    }catch(const exception& e){
+        ofLogWarning("ColorspaceDisplayer",string("exact ranges sweep failed: ")+e.what());
+        return;
+    }
+    profiler.record("ranges",sweepStart,sweepTime);
+    for(int c=0;c<3;c++){
+        exactLow[sweepIndex][c]=sweptLow[c];
+        exactHigh[sweepIndex][c]=sweptHigh[c];
+    }
+    exactRangesKnown[sweepIndex]=true;
+    if(rangeMode==DEFAULT_RANGES || (mode!=IMAGE && mode!=COMPARISON)){
+        return;
+    }
+    //the color space shown, or being converted to, may still have the default ranges
+    int target= conversion.valid() ? conversionIndex : colorspaceIndex;
+    if(!exactRangesKnown[target]){
+        sweepExactRanges(target);
+    }else if(target==sweepIndex && gpuConversion){
+        //the shader reads the ranges of the color space
+        applyRanges(*currentColorSpace,colorspaceIndex);
+        splitDirty=true;
+    }else if(target==sweepIndex){
+        startConversion(target,conversion.valid() && conversionMorph);
+    }
+}
+
+bool ColorspaceDisplayer::render(const RenderJob& job){
+    bool spaceChanged=job.space!=colorspaceIndex;
+    if(spaceChanged){
+        setColorspace(job.space);
+    }
+    if(job.image.empty()){
+        if(mode!=SPARSE_CS || spaceChanged){
+            mode=SPARSE_CS;
+            imPath="";
+            updateDisplay();
+        }
+    }else if(mode!=IMAGE || job.image!=imPath){
+        mode=IMAGE;
+        imPath=job.image;
+        cancelConversion();
+        cloud.clear();
+        extractImageColors(imPath);
+        if(cloud.empty()){
+            imPath="";
+            return false;
+        }
+    }else if(spaceChanged){
+        updateDisplay();
+    }
+
+    if(!renderFbo.isAllocated() || renderFbo.getWidth()!=job.width || renderFbo.getHeight()!=job.height){
+        renderFbo.allocate(job.width,job.height,GL_RGBA);
+    }
+    //camera turns around the colors, at the same scale than the interactive view
+    ofCamera camera;
+    float radius=job.distance*ofGetWidth();
+    float azimuth=ofDegToRad(job.azimuth);
+    float elevation=ofDegToRad(job.elevation);
+    ofVec3f target=toWindowSpace(targetLocation);
+    camera.setPosition(target+ofVec3f(radius*sin(azimuth)*cos(elevation),radius*sin(elevation),
+                                      radius*cos(azimuth)*cos(elevation)));
+    camera.lookAt(target);
+    camera.setNearClip(1);
+    camera.setFarClip(radius+4*ofGetWidth());
+
+    renderFbo.begin();
+    ofClear(0,0,0,255);
+    camera.begin();
+    drawScene();
+    camera.end();
+    renderFbo.end();
+
+    ofPixels pixels;
+    renderFbo.readToPixels(pixels);
+    return ofSaveImage(pixels,job.output);
+}
+
+void ColorspaceDisplayer::runRenderJobs(){
+    int failed=0;
+    for(size_t i=0;i<renderJobs.size();i++){
+        if(render(renderJobs[i])){
+            ofLogNotice("ColorspaceDisplayer","rendered "+renderJobs[i].output);
+        }else{
+            ofLogError("ColorspaceDisplayer","can't render "+renderJobs[i].output);
+            failed++;
+        }
+    }
+    ofExit(failed==0 ? 0 : 1);
 }
 
 void ColorspaceDisplayer::save() {
@@ -164,9 +1445,20 @@ void ColorspaceDisplayer::save() {
    }
 }
 void ColorspaceDisplayer::updateDisplay(){
+    splitDirty=true;
     switch (mode) {
     case IMAGE:
-        extractImageColors(imPath);
+    case COMPARISON:
+        if(gpuConversion){
+            //the shader converts with the current color space : nothing to compute
+            break;
+        }
+        //colors are already extracted, only coordinates change
+        convertImageColors();
+        {
+            ScopedTimer timer(profiler,"upload");
+            cloudRenderer.uploadCoordinates(cloud);
+        }
         break;
     case SPARSE_CS:
         generateSparseColorSpace();
@@ -183,7 +1475,7 @@ void ColorspaceDisplayer::keyPressed(int key){
         if(saveDialog.bSuccess){
             imPath=saveDialog.getPath();
             mode=IMAGE;
-            updateDisplay();
+            extractImageColors(imPath);
         }
     }else if(key=='h' || key=='H'){
         if(showHelp){
@@ -192,75 +1484,74 @@ void ColorspaceDisplayer::keyPressed(int key){
             showHelp=true;
         }
     }else if(key==OF_KEY_RETURN){
+        cancelConversion();
         mode=SPARSE_CS;
+        resetPicking();
+        clearBrush();
         updateDisplay();
     }else if(key=='a'|| key=='A'){
         showAxis=!showAxis;
-    }else{
-        switch(key){
-        case OF_KEY_F1:
-            delete currentColorSpace;
-            currentColorSpace=new cs::XYZ();
-            xAxisName="X";
-            yAxisName="Y";
-            zAxisName="Z";
-            break;
-        case OF_KEY_F2:
-            delete currentColorSpace;
-            currentColorSpace=new cs::LUV();
-            xAxisName="L";
-            yAxisName="U";
-            zAxisName="V";
-            updateDisplay();
-            break;
-        case OF_KEY_F3:
-            delete currentColorSpace;
-            currentColorSpace=new cs::LAB();
-            xAxisName="L";
-            yAxisName="A";
-            zAxisName="B";
-            updateDisplay();
-            break;
-        case OF_KEY_F4:
-            delete currentColorSpace;
-            currentColorSpace=new cs::AC1C2();
-            xAxisName="A";
-            yAxisName="C1";
-            zAxisName="C2";
-            updateDisplay();
-            break;
-        case OF_KEY_F5:
-            delete currentColorSpace;
-            currentColorSpace=new cs::YC1C2();
-            xAxisName="Y";
-            yAxisName="C1";
-            zAxisName="C2";
-            updateDisplay();
-            break;
-        case OF_KEY_F6:
-            delete currentColorSpace;
-            currentColorSpace=new cs::HSI();
-            xAxisName="H";
-            yAxisName="S";
-            zAxisName="I";
-            updateDisplay();
-            break;
-        case OF_KEY_F7:
-            delete currentColorSpace;
-            currentColorSpace=new cs::I1I2I3();
-            xAxisName="I1";
-            yAxisName="I2";
-            zAxisName="I3";
-            updateDisplay();
-            break;
-        case OF_KEY_F8:
-            delete currentColorSpace;
-            currentColorSpace=new cs::H1H2H3();
-            xAxisName="H1";
-            yAxisName="H2";
-            zAxisName="H3";
+    }else if((key=='c'|| key=='C') && mode==IMAGE){
+        exportConvertedImage();
+    }else if(key=='p'|| key=='P'){
+        showProfiler=!showProfiler;
+    }else if(key=='d'|| key=='D'){
+        saveTrace();
+    }else if(key=='v'|| key=='V'){
+        splitLayout= splitLayout==1 ? 4 : splitLayout==4 ? cs::COLORSPACE_COUNT : 1;
+        splitDirty=true;
+        resetPicking();
+    }else if(key=='u'|| key=='U'){
+        gpuConversion=!gpuConversion;
+        resetPicking();
+        if(mode!=SPARSE_CS){
+            convertImageColors();
+            if(!brushColors.empty()){
+                uploadCloud(brushColors.data());
+            }else{
+                uploadCloud(displayColors.empty() ? NULL : displayColors.data());
+            }
+        }
+    }else if(key=='g'|| key=='G'){
+        showHull=!showHull;
+    }else if((key=='o'|| key=='O') && mode==COMPARISON){
+        comparisonOperation=cs::GamutComparison::Operation((comparisonOperation+1)%cs::GamutComparison::OPERATION_COUNT);
+        computeComparison();
+    }else if(key=='m'|| key=='M'){
+        morphEnabled=!morphEnabled;
+    }else if(key=='b'|| key=='B'){
+        setImageView(!showImageView);
+    }else if(key=='r'|| key=='R'){
+        volumeRendering=!volumeRendering;
+    }else if(key=='n'|| key=='N'){
+        rangeMode=RANGE_MODE((rangeMode+1)%3);
+        //the GPU renderer reads the ranges of the color space, nothing is converted
+        applyRanges(*currentColorSpace,colorspaceIndex);
+        updateDisplay();
+    }else if(key=='t'|| key=='T'){
+        showStats=!showStats;
+    }else if(key=='f'|| key=='F'){
+        showFilter=!showFilter;
+    }else if((key=='k'|| key=='K') && showFilter){
+        //the clip plane facing the camera stays in place, a new one starts in front of the colors
+        if(clipSlider>0 && fixedClipPlanes.size()+1<size_t(PointFilter::MAX_CLIP_PLANES)){
+            fixedClipPlanes.push_back(getViewClipPlane(clipSlider));
+            clipSlider=0;
+        }else{
+            fixedClipPlanes.clear();
+        }
+    }else if(key>=OF_KEY_F1 && key<OF_KEY_F1+cs::COLORSPACE_COUNT){
+        bool morph=morphEnabled && (mode==IMAGE || mode==COMPARISON) && key-OF_KEY_F1!=colorspaceIndex;
+        if((mode==IMAGE || mode==COMPARISON) && !gpuConversion){
+            //frames are drawn in the shown color space during the conversion, the next switch cancels it
+            startConversion(key-OF_KEY_F1,morph);
+        }else{
+            //the start is drawn in the shown color space, with its ranges
+            if(morph){
+                startMorph();
+            }
+            setColorspace(key-OF_KEY_F1);
             updateDisplay();
-            break;
         }
     }
 
@@ -282,6 +1573,22 @@ void ColorspaceDisplayer::createHelpGui(){
     helpPanel.add(F8Label.setup("F8 ","H1H2H3 color space "));
     helpPanel.add(EnterLabel.setup("ENTER ","global view of color space (default)"));
     helpPanel.add(iLabel.setup("i ","display colors of an image"));
+    helpPanel.add(dropLabel.setup("drop ","drop images to compare their colors"));
+    helpPanel.add(oLabel.setup("o ","next comparison (union, intersection, unique)"));
+    helpPanel.add(gLabel.setup("g ","show/hide gamut hull"));
+    helpPanel.add(cLabel.setup("c ","save image converted to color space"));
+    helpPanel.add(pLabel.setup("p ","show/hide stages timings"));
+    helpPanel.add(dLabel.setup("d ","save timings as a Chrome trace"));
+    helpPanel.add(vLabel.setup("v ","split view : 4 color spaces, 8, single"));
+    helpPanel.add(uLabel.setup("u ","convert image colors on the GPU / CPU"));
+    helpPanel.add(mLabel.setup("m ","animate/jump color space changes"));
+    helpPanel.add(clickLabel.setup("click ","pin/unpin the color under the mouse"));
+    helpPanel.add(bLabel.setup("b ","show/hide the image, drag to brush"));
+    helpPanel.add(fLabel.setup("f ","show/hide the channel ranges and clip plane"));
+    helpPanel.add(kLabel.setup("k ","keep the clip plane in place / remove kept planes"));
+    helpPanel.add(rLabel.setup("r ","draw image colors as points / as a volume"));
+    helpPanel.add(tLabel.setup("t ","show/hide channel histograms and statistics"));
+    helpPanel.add(nLabel.setup("n ","channel ranges : default, exact, fitted to the image"));
 
 }
 
@@ -292,22 +1599,49 @@ void ColorspaceDisplayer::keyReleased(int key){
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::mouseMoved(int x, int y ){
-
+    mousePosition.set(x,y);
+    hoveredColor=pickColor(x,y);
 }
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::mouseDragged(int x, int y, int button){
-
+    if(brushing){
+        brushEnd.set(x,y);
+    }
 }
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::mousePressed(int x, int y, int button){
-
+    pressPosition.set(x,y);
+    hoveredColor=-1;
+    if(isOverPanel(x,y)){
+        return;
+    }
+    if(showImageView && mode==IMAGE && button==OF_MOUSE_BUTTON_LEFT){
+        brushing=true;
+        brushEnd.set(x,y);
+    }
 }
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::mouseReleased(int x, int y, int button){
-
+    bool click=pressPosition.distance(ofVec2f(x,y))<3;
+    if(brushing){
+        brushing=false;
+        if(!click){
+            //a rectangle started on the image selects pixels, anywhere else it selects colors
+            if(getImageViewRect().inside(pressPosition.x,pressPosition.y)){
+                brushImage(pressPosition.x,pressPosition.y,x,y);
+            }else{
+                brushCloud(pressPosition.x,pressPosition.y,x,y);
+            }
+            return;
+        }
+    }
+    //a click, not the end of a camera move : pick the color under the mouse, or unpick
+    if(button==OF_MOUSE_BUTTON_LEFT && click && !isOverPanel(x,y)){
+        pickedColor=pickColor(x,y);
+    }
 }
 
 //--------------------------------------------------------------
@@ -322,7 +1656,9 @@ void ColorspaceDisplayer::mouseExited(int x, int y){
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::windowResized(int w, int h){
-
+    //colors are stored in the normalized color space : applySceneTransform
+    //follows the window size, nothing to rebuild
+    filterPanel.setPosition(w-filterPanel.getWidth()-10,10);
 }
 
 //--------------------------------------------------------------
@@ -332,6 +1668,73 @@ void ColorspaceDisplayer::gotMessage(ofMessage msg){
 
 //--------------------------------------------------------------
 void ColorspaceDisplayer::dragEvent(ofDragInfo dragInfo){
+    if(dragInfo.files.size()==1){
+        imPath=dragInfo.files[0];
+        mode=IMAGE;
+        extractImageColors(imPath);
+    }else if(dragInfo.files.size()>1){
+        compareImages(dragInfo.files);
+    }
+
+}
 
+void ColorspaceDisplayer::createFilterGui(){
+    filterPanel.setup("Filter");
+    for(int c=0;c<3;c++){
+        filterPanel.add(rangeSliders[c][0].setup(string(AXIS_NAMES[colorspaceIndex][c])+" min",0,0,1));
+        filterPanel.add(rangeSliders[c][1].setup(string(AXIS_NAMES[colorspaceIndex][c])+" max",1,0,1));
+    }
+    filterPanel.add(clipSlider.setup("clip depth",0,0,1));
+    filterPanel.setPosition(ofGetWidth()-filterPanel.getWidth()-10,10);
 }
 
+void ColorspaceDisplayer::updateFilter(){
+    filter=PointFilter();
+    //channel ranges are those of the current color space : split views are not filtered
+    if(showFilter && splitLayout==1 && mode!=SPARSE_CS){
+        for(int c=0;c<3;c++){
+            //sliders at their ends don't bound the channel
+            float low=rangeSliders[c][0];
+            float high=rangeSliders[c][1];
+            filter.setRange(c,low>0 ? low : -1e30f,high<1 ? high : 1e30f);
+        }
+        for(size_t i=0;i<fixedClipPlanes.size();i++){
+            const ofVec4f& p=fixedClipPlanes[i];
+            filter.addClipPlane(ofVec3f(p.x,p.y,p.z),p.w);
+        }
+        if(clipSlider>0){
+            ofVec4f p=getViewClipPlane(clipSlider);
+            filter.addClipPlane(ofVec3f(p.x,p.y,p.z),p.w);
+        }
+    }
+    cloudRenderer.setFilter(filter);
+    gpuRenderer.setFilter(filter);
+    volumeRenderer.setFilter(filter);
+}
+
+ofVec4f ColorspaceDisplayer::getViewClipPlane(float depth){
+    //a normal in the window space is scaled, not divided, by the scene transform
+    ofVec3f look=cam.getLookAtDir();
+    ofVec3f normal=ofVec3f(look.x*ofGetWidth(),look.y*ofGetHeight(),look.z*ofGetWidth()).getNormalized();
+    //depth 0 and 1 : planes touching the cube, half its diagonal away from the center
+    float distance=(depth-0.5f)*sqrt(3.f);
+    return ofVec4f(normal.x,normal.y,normal.z,-normal.dot(CUBE_CENTER)-distance);
+}
+
+bool ColorspaceDisplayer::isOverPanel(float x, float y){
+    return (showFilter && filterPanel.getShape().inside(x,y)) || (showHelp && helpPanel.getShape().inside(x,y));
+}
+
+void ColorspaceDisplayer::updateVolume(){
+    ScopedTimer timer(profiler,"volume");
+    //same colors than the points
+    const uint32_t* colors=cloud.keys();
+    if(!brushColors.empty()){
+        colors=brushColors.data();
+    }else if(!displayColors.empty()){
+        colors=displayColors.data();
+    }
+    densityGrid.build(cloud.c1(),cloud.c2(),cloud.c3(),cloud.counts(),colors,cloud.size(),VOLUME_RESOLUTION);
+    volumeRenderer.upload(densityGrid);
+    volumeDirty=false;
+}
@@ -2,40 +2,217 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
-#include "colorspace/colorspaceinterface.h"
+#include "colorspace/colorspaces.h"
+#include "colorspace/colorcloud.h"
+#include "colorspace/densecolorcounter.h"
+#include "colorspace/colorindex.h"
+#include "colorspace/gamutcomparison.h"
+#include "colorspace/convexhull.h"
+#include "colorspace/pointgrid.h"
+#include "colorspace/densitygrid.h"
+#include "colorspace/channelstats.h"
+#include "colorspace/channelranges.h"
+#include "colorcloudrenderer.h"
+#include "gpucolorcloudrenderer.h"
+#include "volumerenderer.h"
+#include "pointfilter.h"
+#include "colorcloudcache.h"
+#include "convertedimagewriter.h"
+#include "profiler.h"
+#include "renderjob.h"
 #include "ofxSystemUtils.h"
+#include <future>
 
-enum DATAVIZ_MODE{SPARSE_CS,IMAGE};
+enum DATAVIZ_MODE{SPARSE_CS,IMAGE,COMPARISON};
+enum RANGE_MODE{DEFAULT_RANGES,EXACT_RANGES,FITTED_RANGES};
 
 class ColorspaceDisplayer : public ofBaseApp{
 private:
+    cs::ThreadPool threadPool;/*!< threads of all the parallel stages, see cs::ThreadPool::setCurrent*/
     /**
     * @brief currentColorSpace convert a color from RGB color space to a given color space
     */
     cs::ColorspaceInterface* currentColorSpace;
+    int colorspaceIndex;/*!< index of currentColorSpace, see cs::createColorspace*/
+    /**
+    * @brief rangeMode ranges normalizing the colors of the image (IMAGE and
+    * COMPARISON modes)
+    *
+    * DEFAULT_RANGES : ranges documented by each color space
+    * EXACT_RANGES : ranges of all the 8 bits rgb colors, see cs::computeExactRanges
+    * FITTED_RANGES : ranges of the colors of the image, see cs::fitRanges
+    */
+    RANGE_MODE rangeMode;
+    double defaultLow[cs::COLORSPACE_COUNT][3];/*!< lowest value of each channel of each color space, as documented*/
+    double defaultHigh[cs::COLORSPACE_COUNT][3];/*!< highest value of each channel of each color space, as documented*/
+    double exactLow[cs::COLORSPACE_COUNT][3];/*!< lowest value of each channel of each color space, once swept*/
+    double exactHigh[cs::COLORSPACE_COUNT][3];/*!< highest value of each channel of each color space, once swept*/
+    bool exactRangesKnown[cs::COLORSPACE_COUNT];/*!< true once the exact ranges of a color space are swept*/
+    /**
+    * @brief rangesSweep sweep of the exact ranges of a color space, running on
+    * threadPool while frames are drawn, invalid if none
+    *
+    * Colors are normalized with the default ranges until it ends, then
+    * converted again (see updateRangesSweep).
+    */
+    future<void> rangesSweep;
+    cs::CancellationToken sweepToken;/*!< stops the parallel loops of rangesSweep*/
+    int sweepIndex;/*!< index of the color space swept by rangesSweep*/
+    double sweptLow[3];/*!< lowest value of each channel, written by rangesSweep*/
+    double sweptHigh[3];/*!< highest value of each channel, written by rangesSweep*/
+    uint64_t sweepStart;/*!< start of rangesSweep, see Profiler::now*/
+    uint64_t sweepTime;/*!< duration of rangesSweep, see Profiler::now*/
     /**
     * @brief MODE what kind of data display ?
     *
     * SPARCE_CS : a sparse version of the entire color space
     * IMAGE : colors taken in a given image
+    * COMPARISON : union, intersection... of the colors of several images
     */
     DATAVIZ_MODE mode;
     /**
     * @brief colorspace a set of elements, one element by displayed color
     *
+    * Vertices are in the normalized color space, see applySceneTransform
+    *
     * In SPARCE_CS mode : a square by color
-    * In IMAGE mode : a poiny by color
+    * In IMAGE mode : unused, see cloud
     */
     ofMesh colorspace;
-    ofEasyCam cam;/*!< to navigate in 3d scene*/
+    cs::ColorIndex imageIndex;/*!< distinct colors of the 8 bits image of IMAGE mode and the index in cloud of the color of each pixel, cleared once viewIds and cloud are filled*/
+    cs::ColorCloud cloud;/*!< distinct colors of the image and their coordinates (IMAGE mode)*/
+    vector<unsigned short> highDepthColors;/*!< distinct colors of a 16 bits image, empty for 8 bits images*/
+    ColorCloudRenderer cloudRenderer;/*!< draw the cloud (IMAGE mode)*/
+    GpuColorCloudRenderer gpuRenderer;/*!< draw the cloud converted by the GPU (IMAGE mode)*/
+    bool gpuConversion;/*!< if true, colors of the cloud are converted by the GPU, not by the CPU*/
+    /**
+    * @brief volumeRendering if true the cloud is drawn as a volume : the density
+    * of its pixels in each cell of a grid, instead of a point by color
+    *
+    * Points overdraw each other and cost a vertex each, the volume cost only
+    * depends on the window and the grid. Needs the coordinates of the colors :
+    * not available with GPU conversion.
+    */
+    bool volumeRendering;
+    cs::DensityGrid densityGrid;/*!< pixels of the cloud binned in the normalized color space*/
+    VolumeRenderer volumeRenderer;/*!< draw densityGrid*/
+    bool volumeDirty;/*!< true if coordinates or colors changed since densityGrid was built*/
+    /**
+    * @brief channelStats histogram and statistics of each channel of the pixels
+    * of the image, in the current color space
+    *
+    * Computed while the colors are converted, weighted by the number of pixels
+    * of each distinct color : a color space change never reads the pixels again.
+    */
+    cs::ChannelStats channelStats;
+    bool showStats;/*!< if true draw channelStats*/
+    bool morphEnabled;/*!< if true, colors move from a color space to the next one instead of jumping*/
+    uint64_t morphStartFrame;/*!< frame number at the start of the morph*/
+    vector<uint32_t> displayColors;/*!< packed display color of each color of the cloud, empty to draw the colors themselves*/
+    ColorCloudCache cache;/*!< colors of previously analyzed images*/
+    /**
+    * @brief conversion conversion of the image colors to a new color space,
+    * running on threadPool while frames are drawn, invalid if none
+    *
+    * Colors are converted to convertedCoordinates with conversionSpace, so the
+    * displayed colors and currentColorSpace are never touched by the
+    * background thread. The shown color space (currentColorSpace, its axis
+    * names, picking and statistics) stays the previous one until updateConversion
+    * swaps in conversionSpace with the converted colors. Another color space
+    * switch cancels it with conversionToken.
+    */
+    future<void> conversion;
+    cs::CancellationToken conversionToken;/*!< stops the parallel loops of conversion*/
+    cs::ColorspaceInterface* conversionSpace;/*!< color space of conversion, becomes currentColorSpace once converted*/
+    int conversionIndex;/*!< index of conversionSpace, see cs::createColorspace*/
+    bool conversionMorph;/*!< if true, colors morph from the shown ones to the converted ones*/
+    vector<float> convertedCoordinates;/*!< c1, c2 then c3 plane written by conversion*/
+    cs::ChannelStats convertedStats;/*!< statistics of convertedCoordinates*/
+    uint64_t conversionStart;/*!< start of conversion, see Profiler::now*/
+    uint64_t conversionTime;/*!< duration of conversion, see Profiler::now*/
+    cs::GamutComparison comparison;/*!< colors of each compared image (COMPARISON mode)*/
+    cs::GamutComparison::Operation comparisonOperation;/*!< displayed comparison*/
+    cs::ConvexHull hull;/*!< convex hull of the displayed colors*/
+    double voxelVolume;/*!< fraction of the color space filled by the displayed colors*/
+    uint64_t gamutTime;/*!< time spent measuring the gamut, in ms*/
+    ofMesh hullMesh;/*!< wireframe of the hull*/
+    bool showHull;/*!< if true draw the hull over the colors*/
+    Profiler profiler;/*!< time spent in each stage of the pipeline*/
+    uint64_t lastFrameStart;/*!< start of the previous frame, in microseconds*/
+    bool showProfiler;/*!< if true draw the stages timings*/
+    cs::PointGrid pickGrid;/*!< displayed colors sorted by cell, to find the color under the mouse*/
+    bool pickGridDirty;/*!< true if the displayed coordinates changed since pickGrid was built*/
+    long hoveredColor;/*!< index of the displayed color under the mouse, -1 if none*/
+    long pickedColor;/*!< index of the displayed color clicked by the user, -1 if none*/
+    ofVec2f mousePosition;/*!< last mouse position*/
+    ofVec2f pressPosition;/*!< mouse position when the button was pressed, to tell clicks from camera moves*/
+    /**
+    * @brief showImageView if true the image is drawn next to its colors, and
+    * brushing links both views
+    *
+    * A rectangle dragged over the colors highlights their pixels in the image,
+    * a rectangle dragged over the image highlights the colors of its pixels.
+    */
+    bool showImageView;
+    string viewPath;/*!< image whose pixels were indexed for the image view*/
+    ofPixels viewPixels;/*!< pixels of the image view, the image downsampled to IMAGE_VIEW_SIZE*/
+    ofTexture viewTexture;/*!< viewPixels on the GPU*/
+    vector<uint32_t> viewIds;/*!< index in cloud of the color of each pixel of the view, empty if the view can't be linked*/
+    ofPixels viewMask;/*!< rgba overlay darkening the pixels whose color is not selected*/
+    ofTexture viewMaskTexture;/*!< viewMask on the GPU*/
+    vector<uint8_t> brushSelection;/*!< 1 for each color of the cloud selected by brushing, empty without selection*/
+    vector<uint32_t> brushColors;/*!< packed display color of each color of the cloud while brushing*/
+    size_t brushedPixels;/*!< number of pixels of the image whose color is selected*/
+    bool brushing;/*!< true while a brushing rectangle is dragged*/
+    ofVec2f brushEnd;/*!< mouse position at the end of the brushing rectangle*/
+    /**
+    * @brief showFilter if true the filter panel is drawn and filters the colors
+    * of IMAGE and COMPARISON modes, in the single view
+    *
+    * Colors out of the channel ranges or behind a clip plane are hidden by the
+    * vertex shaders : moving a slider doesn't convert nor upload anything.
+    */
+    bool showFilter;
+    ofxPanel filterPanel;/*!< channel ranges and clip plane sliders*/
+    ofxFloatSlider rangeSliders[3][2];/*!< lowest and highest normalized value of each channel*/
+    ofxFloatSlider clipSlider;/*!< depth of the clip plane facing the camera, 0 to clip nothing*/
+    vector<ofVec4f> fixedClipPlanes;/*!< clip planes kept in place when the camera moves*/
+    PointFilter filter;/*!< colors hidden by the filter panel, accepts all the colors when the filter is off*/
+    ofEasyCam cam;/*!< to navigate in 3d scene, shared by all the viewports*/
+    /**
+    * @brief splitLayout number of viewports, each one showing the colors in another color space
+    *
+    * 1 : single view of the current color space
+    * 4 : 2x2 views, from the current color space to the third next one
+    * 8 : 2x4 views, all the color spaces starting at the current one
+    */
+    int splitLayout;
+    cs::ColorspaceInterface* splitSpaces[cs::COLORSPACE_COUNT];/*!< one color space by index, for split views*/
+    ColorCloudRenderer splitRenderers[cs::COLORSPACE_COUNT];/*!< colors of each viewport*/
+    vector<float> splitCoordinates[cs::COLORSPACE_COUNT];/*!< c1, c2 then c3 plane of each viewport*/
+    bool splitDirty;/*!< true if the colors or the color spaces of the viewports changed since last upload*/
+    ofMesh splitHullMeshes[cs::COLORSPACE_COUNT];/*!< wireframe of the hull of the colors of each viewport*/
+    bool splitHullsDirty;/*!< true if the viewports coordinates changed since their hulls were computed*/
+    cs::ColorCloud sparseCloud;/*!< colors of the sparse color space, drawn as points in split views*/
+    vector<float> sparseCoordinates[cs::COLORSPACE_COUNT];/*!< c1, c2 then c3 plane of the sparse colors in each color space*/
+    vector<RenderJob> renderJobs;/*!< renders of the headless mode*/
+    ofFbo renderFbo;/*!< offscreen target of the headless renders*/
     string imPath;/*!< path to the image selected by the user in IMAGE mode*/
-    ofVec3f targetLocation;/*!< camera location*/
+    ofVec3f targetLocation;/*!< camera target, in the normalized color space*/
     string xAxisName;/*!< name of the first color channel*/
     string yAxisName;/*!< name of the second color channel*/
     string zAxisName;/*!< name of the third color channel*/
     bool showAxis;/*!< if true draw color space axis*/
 public:
-    ColorspaceDisplayer();
+    /**
+     * @brief ColorspaceDisplayer
+     * @param renderJobs if not empty, headless mode : the jobs are rendered to
+     * files when the app starts, then the app exits
+     * @param threads number of threads of the parallel stages, 0 for the number of cores
+     * @param pinThreads if true, each thread runs on its own core (Linux only)
+     */
+    ColorspaceDisplayer(const vector<RenderJob>& renderJobs=vector<RenderJob>(), unsigned int threads=0,
+                        bool pinThreads=false);
     ~ColorspaceDisplayer();
     void setup();
     void update();
@@ -58,25 +235,402 @@ private:
      */
     void save();
     /**
-     * @brief getCoordinates convert color from rgb to selected color space
-     * and give it a position according its 3 channels in this color space
-     * @param color
-     * @return
+     * @brief setColorspace change the current color space, display is not updated
+     * and a background conversion to another color space is dropped
+     * @param index see cs::createColorspace
+     */
+    void setColorspace(int index);
+    /**
+     * @brief updateAxisNames name the axis and the range sliders after the
+     * channels of the current color space
+     */
+    void updateAxisNames();
+    /**
+     * @brief applyRanges give a color space the ranges of rangeMode, the
+     * exact ones for FITTED_RANGES (colors are fitted once converted)
+     *
+     * Exact ranges are swept on threadPool the first time a color space of the
+     * image colors needs them, default ranges are given meanwhile. The sparse
+     * color space has no ranges to show : nothing is swept.
+     * @param space color space to set
+     * @param index index of space, see cs::createColorspace
+     */
+    void applyRanges(cs::ColorspaceInterface& space, int index);
+    /**
+     * @brief sweepExactRanges start the sweep of the exact ranges of a color
+     * space, see rangesSweep, unless a sweep is running
+     * @param index see cs::createColorspace
+     */
+    void sweepExactRanges(int index);
+    /**
+     * @brief updateRangesSweep keep the exact ranges of rangesSweep once it is
+     * over, and convert the colors again with them
+     */
+    void updateRangesSweep();
+    /**
+     * @brief drawScene draw axis and colors, inside a camera
+     */
+    void drawScene();
+    /**
+     * @brief drawAxis draw the axis of the color space, inside a camera
+     * @param origin origin of the axis, in the normalized color space
+     */
+    void drawAxis(const ofVec3f& origin);
+    /**
+     * @brief applySceneTransform scale the normalized color space ([0;1]^3) to the window
+     *
+     * Displayed colors are stored in the normalized color space and placed by
+     * this model matrix only : nothing is rebuilt when the window is resized.
+     */
+    void applySceneTransform();
+    /**
+     * @brief toWindowSpace
+     * @param position position in the normalized color space
+     * @return position after applySceneTransform
+     */
+    ofVec3f toWindowSpace(const ofVec3f& position);
+    /**
+     * @brief fromWindowSpace
+     * @param position position after applySceneTransform
+     * @return position in the normalized color space
+     */
+    ofVec3f fromWindowSpace(const ofVec3f& position);
+    /**
+     * @brief pickColor find the displayed color under a point of the window
+     *
+     * The mouse ray is cast in the normalized color space, through pickGrid
+     * (rebuilt if coordinates changed). Not available in split views, nor with
+     * GPU conversion (colors have no CPU coordinates).
+     *
+     * @param x
+     * @param y
+     * @return index of the color in the displayed colors (cloud, or sparse colors), -1 if none
+     */
+    long pickColor(int x, int y);
+    /**
+     * @brief getDisplayedCoordinates
+     * @param[out] c1 first normalized coordinate of each displayed color
+     * @param[out] c2 second normalized coordinate of each displayed color
+     * @param[out] c3 third normalized coordinate of each displayed color
+     * @return number of displayed colors
+     */
+    size_t getDisplayedCoordinates(const float*& c1, const float*& c2, const float*& c3);
+    /**
+     * @brief describeColor
+     * @param index index of a displayed color
+     * @return rgb and color space values of the color
+     */
+    string describeColor(long index);
+    /**
+     * @brief drawPickedColors frame the hovered and picked colors, inside the scene transform
+     */
+    void drawPickedColors();
+    /**
+     * @brief resetPicking forget hovered and picked colors, displayed colors changed
+     */
+    void resetPicking();
+    /**
+     * @brief setImageView show or hide the image view, the camera can't be moved
+     * with the mouse while the view is shown : the mouse brushes
+     * @param show
+     */
+    void setImageView(bool show);
+    /**
+     * @brief indexImage find the distinct colors of an 8 bits image and the
+     * color of each pixel in one parallel scan, then build the image view
+     * @param data interleaved pixels values
+     * @param width number of pixels by row
+     * @param height number of rows
+     * @param channels number of channels per pixel
+     */
+    void indexImage(const unsigned char* data, size_t width, size_t height, size_t channels);
+    /**
+     * @brief buildImageView downsample an image indexed by imageIndex, and the
+     * ids of its pixels
+     *
+     * Only 8 bits images can be linked to their colors : 16 bits colors are
+     * not unique once rounded. Raw dumps have no size, they can't be shown.
+     * @param data interleaved pixels values
+     * @param width number of pixels by row
+     * @param height number of rows
+     * @param channels number of channels per pixel
+     */
+    void buildImageView(const unsigned char* data, size_t width, size_t height, size_t channels);
+    /**
+     * @brief loadImageView index the image of IMAGE mode if its colors were read
+     * from the cache (its pixels were never decoded), once by image
+     */
+    void loadImageView();
+    /**
+     * @brief getImageViewRect
+     * @return where the image view is drawn in the window
+     */
+    ofRectangle getImageViewRect();
+    /**
+     * @brief brushCloud select the colors drawn inside a rectangle of the window
+     * @param x0
+     * @param y0
+     * @param x1
+     * @param y1
+     */
+    void brushCloud(float x0, float y0, float x1, float y1);
+    /**
+     * @brief brushImage select the colors of the pixels inside a rectangle of the image view
+     * @param x0
+     * @param y0
+     * @param x1
+     * @param y1
+     */
+    void brushImage(float x0, float y0, float x1, float y1);
+    /**
+     * @brief applyBrush dim the colors and the pixels out of brushSelection
+     *
+     * The mask of the view is a parallel lookup of the display value of each
+     * pixel's color id (see cs::remapIds).
+     */
+    void applyBrush();
+    /**
+     * @brief clearBrush forget the brushed colors, colors are not uploaded again
+     */
+    void clearBrush();
+    /**
+     * @brief drawImageView draw the image, its mask and the brushing rectangle
+     */
+    void drawImageView();
+    /**
+     * @brief updateVolume bin the cloud in densityGrid, with the displayed colors, and upload it
+     */
+    void updateVolume();
+    /**
+     * @brief createFilterGui create the sliders of the filter panel
+     */
+    void createFilterGui();
+    /**
+     * @brief updateFilter build the filter from the sliders and the camera, and
+     * give it to the renderers
+     */
+    void updateFilter();
+    /**
+     * @brief getViewClipPlane
+     * @param depth depth of the plane in the color space, from 0 (in front of
+     * the cube) to 1 (behind it)
+     * @return plane facing the camera, hiding the colors in front of it : normal
+     * (x, y, z) and offset (w) in the normalized color space
+     */
+    ofVec4f getViewClipPlane(float depth);
+    /**
+     * @brief isOverPanel
+     * @param x
+     * @param y
+     * @return true if a point of the window is on a visible panel
+     */
+    bool isOverPanel(float x, float y);
+    /**
+     * @brief startMorph start moving the displayed colors from where they are
+     * drawn (in the middle of a running morph too), before the new color space
+     * or coordinates are shown
      */
-    ofVec3f getCoordinates(ofColor color);
+    void startMorph();
+    /**
+     * @brief getMorph
+     * @return position between the start (0) and the end (1) of the morph, eased
+     */
+    float getMorph();
+    /**
+     * @brief updateSplitView compute the coordinates of the displayed colors in
+     * the color spaces of all the viewports, in one parallel pass, and upload them
+     */
+    void updateSplitView();
+    /**
+     * @brief updateSplitHulls compute the hull of the colors of each viewport
+     */
+    void updateSplitHulls();
+    /**
+     * @brief drawSplitView draw each viewport with the shared camera
+     *
+     * Viewports are drawn by a camera copying the shared one : the shared camera
+     * is only begun on the whole window, so it is moved from any viewport.
+     */
+    void drawSplitView();
+    /**
+     * @brief getViewColorspace
+     * @param view index of a viewport
+     * @return index of the color space shown by the viewport (see cs::createColorspace)
+     */
+    int getViewColorspace(int view);
+    /**
+     * @brief render render a job to its output file, in an offscreen buffer
+     *
+     * Colors of the image are only extracted if the image changes since the
+     * previous job, and are read from the cache for known images.
+     *
+     * @param job
+     * @return false if the image can't be read or the render can't be written
+     */
+    bool render(const RenderJob& job);
+    /**
+     * @brief runRenderJobs render all the jobs of the headless mode, then exit
+     */
+    void runRenderJobs();
     /**
      * @brief generateSparseColorSpace generate a sparce version of the color space
      *
      * red, green and blue channel are incremented by 8, so not all the colors are
-     * displayed
+     * displayed. Coordinates are read from sparseCoordinates, nothing is converted.
      */
     void generateSparseColorSpace();
     /**
      * @brief extractImageColors extract all the colors in a image and display them
      * by a colored point corresponding to colors values in selected color space
+     *
+     * Results are cached, so a previously analyzed image is not decoded again
      * @param path
      */
     void extractImageColors(string path);
+    /**
+     * @brief extractLowDepthImageColors fill cloud with the colors of an 8 bits image
+     * @param path
+     * @return false if the image can't be read
+     */
+    bool extractLowDepthImageColors(string path);
+    /**
+     * @brief isHighDepthImage test if an image must be read with more than 8 bits per channel
+     * @param path
+     * @return true for tiff (16 bits) and exr/hdr (float) images
+     */
+    bool isHighDepthImage(string path);
+    /**
+     * @brief extractHighDepthImageColors fill cloud with the colors of a 16 bits or float image
+     *
+     * Float images are quantized to 16 bits. Colors are deduplicated with a sparse hash
+     * (16 bits colors can't fit in a bitset) and kept in highDepthColors for conversion.
+     * @param path
+     * @return false if the image can't be read
+     */
+    bool extractHighDepthImageColors(string path);
+    /**
+     * @brief compareImages extract colors of several images, in parallel, and
+     * display the selected comparison between them
+     *
+     * Images that can't be read are left out with a warning, nothing changes
+     * if none can be read.
+     * @param paths
+     */
+    void compareImages(const vector<string>& paths);
+    /**
+     * @brief computeComparison compute and display the selected comparison
+     *
+     * Colors of a single image are drawn with the color of this image, colors
+     * shared by several images in white. The intersection is drawn with its
+     * own colors.
+     */
+    void computeComparison();
+    /**
+     * @brief getSourceColor
+     * @param source index of a compared image
+     * @return packed (0xRRGGBB) color used to draw colors of this image only
+     */
+    uint32_t getSourceColor(size_t source);
+    /**
+     * @brief convertImageColors compute coordinates of the image colors in the
+     * selected color space and move the camera target on them
+     *
+     * Nothing is computed with GPU conversion, the camera looks at the center
+     * of the color space
+     */
+    void convertImageColors();
+    /**
+     * @brief convertColors compute normalized coordinates and statistics of the
+     * image colors, read from the cache if possible, without changing the display
+     *
+     * Only reads the colors of the image : can run on another thread while
+     * frames are drawn, stopped by a cancelled cs::CancellationScope.
+     *
+     * @param space color space used for conversion, fitted to the colors for FITTED_RANGES
+     * @param ranges range mode
+     * @param c1 first channel plane, a value by color
+     * @param c2 second channel plane, a value by color
+     * @param c3 third channel plane, a value by color
+     * @param stats statistics of the coordinates
+     */
+    void convertColors(cs::ColorspaceInterface& space, RANGE_MODE ranges, float* c1, float* c2, float* c3,
+                       cs::ChannelStats& stats);
+    /**
+     * @brief useConvertedColors measure the gamut of the new coordinates of the
+     * cloud and move the camera target on them
+     */
+    void useConvertedColors();
+    /**
+     * @brief startConversion convert the image colors to a new color space
+     * on threadPool, see conversion
+     * @param index index of the new color space, see cs::createColorspace
+     * @param morph if true, colors morph from the shown ones once converted
+     */
+    void startConversion(int index, bool morph);
+    /**
+     * @brief stopConversion stop the background conversion and wait for it, its
+     * color space is dropped
+     */
+    void stopConversion();
+    /**
+     * @brief cancelConversion stop the background conversion and wait for it, its
+     * color space becomes the current one : the caller converts or replaces the colors
+     */
+    void cancelConversion();
+    /**
+     * @brief updateConversion show the colors of the background conversion once
+     * it is over
+     */
+    void updateConversion();
+    /**
+     * @brief uploadCloud upload colors and coordinates of the cloud to the renderer,
+     * only colors with GPU conversion
+     * @param colors display color of each point, NULL for the colors of the cloud
+     */
+    void uploadCloud(const uint32_t* colors=NULL);
+    /**
+     * @brief drawProfiler draw last, median and 95th percentile time of each stage
+     */
+    void drawProfiler();
+    /**
+     * @brief drawStats draw the histogram, mean, standard deviation and
+     * percentiles of each channel, in the units of the color space
+     */
+    void drawStats();
+    /**
+     * @brief saveTrace save the timed stages as a Chrome trace in the data folder
+     */
+    void saveTrace();
+    /**
+     * @brief measureGamut compute the hull and the voxel volume of the displayed
+     * colors, in the normalized ([0;1]^3) color space
+     */
+    void measureGamut();
+    /**
+     * @brief fillHullMesh
+     * @param hull convex hull of colors
+     * @param mesh wireframe of the hull
+     */
+    static void fillHullMesh(const cs::ConvexHull& hull, ofMesh& mesh);
+    /**
+     * @brief exportConvertedImage ask where to save the image displayed in IMAGE
+     * mode, converted pixel by pixel to the selected color space
+     */
+    void exportConvertedImage();
+    /**
+     * @brief convertImage convert every pixel of an image and write the result
+     *
+     * Pixels are converted by tiles with all the cores and streamed to the
+     * output, so the converted image is never in memory. 8 bits images with few
+     * distinct colors only convert their distinct colors (see cs::convertPixels).
+     * A .tif output gets normalized channels in a 16 bits tiff, any other one
+     * gets raw channels in one float file by channel (see ConvertedImageWriter).
+     *
+     * @param path image to convert
+     * @param outputPath
+     * @return false if the image can't be read or the output can't be written
+     */
+    bool convertImage(string path, string outputPath);
     /**
      * @brief updateDisplay update display because displaying mode or color space h
      * has been changed
@@ -102,6 +656,22 @@ private:
     ofxLabel EnterLabel;/*!< how to switch to sparce color space displaying mode */
     ofxLabel iLabel;/*!< how to switch to image colors displaying mode */
     ofxLabel axisLabel;/*!< how to show or hide color space axis */
+    ofxLabel dropLabel;/*!< how to compare several images */
+    ofxLabel oLabel;/*!< how to change comparison */
+    ofxLabel gLabel;/*!< how to show or hide the gamut hull */
+    ofxLabel cLabel;/*!< how to export the converted image */
+    ofxLabel pLabel;/*!< how to show or hide the profiler */
+    ofxLabel dLabel;/*!< how to save the profiler trace */
+    ofxLabel vLabel;/*!< how to split the view */
+    ofxLabel uLabel;/*!< how to convert on the GPU */
+    ofxLabel mLabel;/*!< how to animate color space changes */
+    ofxLabel clickLabel;/*!< how to pick a color */
+    ofxLabel bLabel;/*!< how to show the image view and brush */
+    ofxLabel fLabel;/*!< how to filter colors */
+    ofxLabel kLabel;/*!< how to keep a clip plane */
+    ofxLabel rLabel;/*!< how to draw a volume */
+    ofxLabel tLabel;/*!< how to show channel statistics */
+    ofxLabel nLabel;/*!< how to change channel ranges */
 
 
 };
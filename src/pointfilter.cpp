@@ -0,0 +1,43 @@
+#include "pointfilter.h"
+
+//farther than any normalized coordinate : an unbounded range
+static const float UNBOUNDED=1e30f;
+
+PointFilter::PointFilter():
+    low(-UNBOUNDED,-UNBOUNDED,-UNBOUNDED),high(UNBOUNDED,UNBOUNDED,UNBOUNDED){
+    planeCount=0;
+}
+
+void PointFilter::setRange(int channel, float low, float high){
+    this->low[channel]=low;
+    this->high[channel]=high;
+}
+
+void PointFilter::addClipPlane(const ofVec3f& normal, float offset){
+    if(planeCount<MAX_CLIP_PLANES){
+        planes[planeCount]=ofVec4f(normal.x,normal.y,normal.z,offset);
+        planeCount++;
+    }
+}
+
+bool PointFilter::accepts(float c1, float c2, float c3) const{
+    //written as the shader : NaN coordinates are rejected
+    if(!(c1>=low.x && c2>=low.y && c3>=low.z && c1<=high.x && c2<=high.y && c3<=high.z)){
+        return false;
+    }
+    for(int i=0;i<planeCount;i++){
+        if(planes[i].x*c1+planes[i].y*c2+planes[i].z*c3+planes[i].w<0){
+            return false;
+        }
+    }
+    return true;
+}
+
+void PointFilter::setUniforms(ofShader& shader) const{
+    shader.setUniform3f("filterLow",low.x,low.y,low.z);
+    shader.setUniform3f("filterHigh",high.x,high.y,high.z);
+    shader.setUniform1i("clipPlaneCount",planeCount);
+    if(planeCount>0){
+        shader.setUniform4fv("clipPlanes",&planes[0].x,planeCount);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+
+/**
+ * @brief POINT_FILTER_GLSL declarations of the filter uniforms and the function
+ * bool accepted(vec3 p) (GLSL 1.20), inserted in the vertex shaders of the renderers
+ */
+#define POINT_FILTER_GLSL \
+    "uniform vec3 filterLow;\n" \
+    "uniform vec3 filterHigh;\n" \
+    "uniform vec4 clipPlanes[4];\n" \
+    "uniform int clipPlaneCount;\n" \
+    "bool accepted(vec3 p){\n" \
+    "    if(!(all(greaterThanEqual(p,filterLow)) && all(lessThanEqual(p,filterHigh)))){\n" \
+    "        return false;\n" \
+    "    }\n" \
+    "    for(int i=0;i<4;i++){\n" \
+    "        if(i<clipPlaneCount && dot(clipPlanes[i].xyz,p)+clipPlanes[i].w<0.){\n" \
+    "            return false;\n" \
+    "        }\n" \
+    "    }\n" \
+    "    return true;\n" \
+    "}\n"
+
+/**
+ * @brief The PointFilter class channel ranges and clip planes hiding part of the
+ * displayed colors, in the normalized color space
+ *
+ * The filter is evaluated by the vertex shaders : changing it only changes
+ * uniforms, nothing is converted nor uploaded again.
+ */
+class PointFilter{
+public:
+    static const int MAX_CLIP_PLANES=4;/*!< size of the clipPlanes uniform of POINT_FILTER_GLSL*/
+    /**
+     * @brief PointFilter a filter accepting every point
+     */
+    PointFilter();
+    /**
+     * @brief setRange keep the points with a channel between low and high
+     * @param channel 0, 1 or 2
+     * @param low
+     * @param high
+     */
+    void setRange(int channel, float low, float high);
+    /**
+     * @brief addClipPlane keep the points with dot(normal,p)+offset>=0, ignored if
+     * there are already MAX_CLIP_PLANES planes
+     * @param normal
+     * @param offset
+     */
+    void addClipPlane(const ofVec3f& normal, float offset);
+    /**
+     * @brief accepts same test than the accepted function of POINT_FILTER_GLSL
+     * @param c1
+     * @param c2
+     * @param c3
+     * @return true if the point is shown
+     */
+    bool accepts(float c1, float c2, float c3) const;
+    /**
+     * @brief setUniforms set the uniforms of POINT_FILTER_GLSL, between begin and end of the shader
+     * @param shader
+     */
+    void setUniforms(ofShader& shader) const;
+private:
+    ofVec3f low;/*!< lowest value of each channel*/
+    ofVec3f high;/*!< highest value of each channel*/
+    int planeCount;/*!< number of clip planes*/
+    ofVec4f planes[MAX_CLIP_PLANES];/*!< normal (x, y, z) and offset (w) of each clip plane*/
+};
@@ -0,0 +1,102 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+Profiler::Profiler(): nextEvent(0){
+}
+
+uint64_t Profiler::now(){
+    return uint64_t(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::record(const string& stage, uint64_t start, uint64_t duration){
+    map<string,Samples>::iterator it=samples.find(stage);
+    if(it==samples.end()){
+        Samples s;
+        s.next=0;
+        it=samples.insert(make_pair(stage,s)).first;
+    }
+    Samples& s=it->second;
+    double ms=duration/1000.;
+    if(s.durations.size()<WINDOW){
+        s.durations.push_back(ms);
+    }else{
+        s.durations[s.next]=ms;
+    }
+    s.next=(s.next+1)%WINDOW;
+
+    //map keys never move : events point to them instead of copying names
+    Event e={&it->first,start,duration};
+    if(events.size()<MAX_EVENTS){
+        events.push_back(e);
+    }else{
+        events[nextEvent]=e;
+    }
+    nextEvent=(nextEvent+1)%MAX_EVENTS;
+}
+
+vector<string> Profiler::getStages() const{
+    vector<string> stages;
+    for(map<string,Samples>::const_iterator it=samples.begin();it!=samples.end();it++){
+        stages.push_back(it->first);
+    }
+    return stages;
+}
+
+Profiler::Stats Profiler::getStats(const string& stage) const{
+    Stats stats={0,0,0,0,0};
+    map<string,Samples>::const_iterator it=samples.find(stage);
+    if(it==samples.end() || it->second.durations.empty()){
+        return stats;
+    }
+    const Samples& s=it->second;
+    vector<double> sorted(s.durations);
+    sort(sorted.begin(),sorted.end());
+    stats.last=s.durations[(s.next+s.durations.size()-1)%s.durations.size()];
+    stats.p50=sorted[sorted.size()/2];
+    stats.p95=sorted[min(sorted.size()-1,sorted.size()*95/100)];
+    stats.max=sorted.back();
+    stats.count=sorted.size();
+    return stats;
+}
+
+bool Profiler::saveTrace(string path) const{
+    ofstream out(path.c_str());
+    if(!out){
+        return false;
+    }
+    //complete events ("X"), times in microseconds
+    out<<"{\"traceEvents\":[\n";
+    //once the ring is full, the oldest event is the next overwritten one
+    size_t oldest= events.size()<MAX_EVENTS ? 0 : nextEvent;
+    for(size_t i=0;i<events.size();i++){
+        const Event& e=events[(oldest+i)%events.size()];
+        out<<"{\"name\":\""<<*e.stage<<"\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"<<e.start
+           <<",\"dur\":"<<e.duration<<"}"<<(i+1<events.size() ? ",\n" : "\n");
+    }
+    out<<"],\"displayTimeUnit\":\"ms\"}\n";
+    return bool(out);
+}
+
+void Profiler::clear(){
+    samples.clear();
+    events.clear();
+    nextEvent=0;
+}
+
+ScopedTimer::ScopedTimer(Profiler& profiler, const string& stage):
+    profiler(profiler), stage(stage), start(Profiler::now()), running(true){
+}
+
+ScopedTimer::~ScopedTimer(){
+    stop();
+}
+
+void ScopedTimer::stop(){
+    if(running){
+        profiler.record(stage,start,Profiler::now()-start);
+        running=false;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief The Profiler class times the stages of the pipeline (decode, dedup,
+ * convert, mesh, upload, draw...)
+ *
+ * For each stage the last durations are kept to give rolling percentiles. The
+ * last timed events are also kept (up to a limit) to be saved as a Chrome trace
+ * (chrome://tracing, or ui.perfetto.dev). Stages are timed from the main thread.
+ */
+class Profiler{
+public:
+    /**
+     * @brief The Stats struct durations of a stage, in milliseconds, over the last samples
+     */
+    struct Stats{
+        double last;
+        double p50;
+        double p95;
+        double max;
+        size_t count;/*!< number of samples*/
+    };
+
+    Profiler();
+    /**
+     * @brief now
+     * @return time in microseconds, from an arbitrary origin
+     */
+    static uint64_t now();
+    /**
+     * @brief record add a timed event
+     * @param stage name of the stage
+     * @param start start time (see now)
+     * @param duration duration in microseconds
+     */
+    void record(const string& stage, uint64_t start, uint64_t duration);
+    /**
+     * @brief getStages
+     * @return names of all the timed stages
+     */
+    vector<string> getStages() const;
+    /**
+     * @brief getStats
+     * @param stage
+     * @return durations of the last samples of a stage
+     */
+    Stats getStats(const string& stage) const;
+    /**
+     * @brief saveTrace write the kept events as a Chrome trace (json), oldest first
+     * @param path
+     * @return false if the file can't be written
+     */
+    bool saveTrace(string path) const;
+    /**
+     * @brief clear remove all events and samples
+     */
+    void clear();
+private:
+    static const size_t WINDOW=240;/*!< samples by stage used for the percentiles*/
+    static const size_t MAX_EVENTS=1<<20;/*!< last events kept for the trace*/
+
+    /**
+     * @brief The Samples struct ring of the last durations of a stage
+     */
+    struct Samples{
+        vector<double> durations;/*!< milliseconds*/
+        size_t next;/*!< index of the next overwritten duration*/
+    };
+    /**
+     * @brief The Event struct a timed event of the trace
+     */
+    struct Event{
+        const string* stage;/*!< key of the stage in samples*/
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    map<string,Samples> samples;/*!< last durations by stage*/
+    vector<Event> events;/*!< ring of the last events for the trace*/
+    size_t nextEvent;/*!< index of the next overwritten event*/
+};
+
+/**
+ * @brief The ScopedTimer class times a scope as a profiler stage
+ */
+class ScopedTimer{
+public:
+    ScopedTimer(Profiler& profiler, const string& stage);
+    ~ScopedTimer();
+    /**
+     * @brief stop record the stage now instead of at the end of the scope
+     */
+    void stop();
+private:
+    ScopedTimer(const ScopedTimer&);
+    ScopedTimer& operator=(const ScopedTimer&);
+
+    Profiler& profiler;
+    string stage;
+    uint64_t start;/*!< microseconds*/
+    bool running;/*!< false once recorded*/
+};
@@ -0,0 +1,137 @@
+#include "renderjob.h"
+#include "colorspace/colorspaces.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+RenderJob::RenderJob(): space(0), width(512), height(512), azimuth(0), elevation(0), distance(1){
+}
+
+/**
+ * @brief parseSpace read a color space given by its name or its number (1 to COLORSPACE_COUNT)
+ * @return false if no color space matches
+ */
+static bool parseSpace(string value, int& space){
+    int number=atoi(value.c_str());
+    if(number>=1 && number<=cs::COLORSPACE_COUNT){
+        space=number-1;
+        return true;
+    }
+    transform(value.begin(),value.end(),value.begin(),::tolower);
+    for(int s=0;s<cs::COLORSPACE_COUNT;s++){
+        cs::ColorspaceInterface* candidate=cs::createColorspace(s);
+        string name=candidate->getName();
+        delete candidate;
+        transform(name.begin(),name.end(),name.begin(),::tolower);
+        if(name==value){
+            space=s;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief parseArguments parse arguments, current options are kept in job
+ */
+static bool parseArguments(const vector<string>& args, RenderJob& job, vector<RenderJob>& jobs, string& error, int depth){
+    for(size_t i=0;i<args.size();i++){
+        const string& option=args[i];
+        //process serial number given by the macOS Finder
+        if(option.compare(0,5,"-psn_")==0){
+            continue;
+        }
+        if(i+1>=args.size()){
+            error="missing value after "+option;
+            return false;
+        }
+        const string& value=args[++i];
+        if(option=="--image"){
+            job.image=value;
+        }else if(option=="--space"){
+            if(!parseSpace(value,job.space)){
+                error="unknown color space "+value;
+                return false;
+            }
+        }else if(option=="--size"){
+            if(sscanf(value.c_str(),"%dx%d",&job.width,&job.height)!=2 || job.width<=0 || job.height<=0){
+                error="invalid size "+value+", expected WIDTHxHEIGHT";
+                return false;
+            }
+        }else if(option=="--camera"){
+            if(sscanf(value.c_str(),"%f,%f,%f",&job.azimuth,&job.elevation,&job.distance)!=3 || job.distance<=0){
+                error="invalid camera "+value+", expected AZIMUTH,ELEVATION,DISTANCE";
+                return false;
+            }
+        }else if(option=="--output"){
+            job.output=value;
+            jobs.push_back(job);
+        }else if(option=="--batch"){
+            //a batch file can't include itself forever
+            if(depth>8){
+                error="too many nested batch files";
+                return false;
+            }
+            ifstream in(value.c_str());
+            if(!in){
+                error="can't read batch file "+value;
+                return false;
+            }
+            vector<string> batchArgs;
+            string line;
+            while(getline(in,line)){
+                if(!line.empty() && line[0]=='#'){
+                    continue;
+                }
+                istringstream words(line);
+                string word;
+                while(words>>word){
+                    batchArgs.push_back(word);
+                }
+            }
+            if(!parseArguments(batchArgs,job,jobs,error,depth+1)){
+                error=value+": "+error;
+                return false;
+            }
+        }else{
+            error="unknown option "+option;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseRenderJobs(const vector<string>& args, vector<RenderJob>& jobs, string& error){
+    RenderJob job;
+    size_t jobCount=jobs.size();
+    if(!parseArguments(args,job,jobs,error,0)){
+        return false;
+    }
+    //options without any render would silently open the interactive window
+    for(size_t i=0;i<args.size() && jobs.size()==jobCount;i++){
+        if(args[i].compare(0,5,"-psn_")!=0){
+            error="no --output given";
+            return false;
+        }
+    }
+    return true;
+}
+
+string getRenderUsage(){
+    return "headless mode : render views to image files, without window\n"
+           "  --image PATH          image whose colors are drawn (default : sparse color space)\n"
+           "  --space NAME|NUMBER   color space (xyz, luv, Lab, AC1C2, YC1C2, hsi, i1i2i3, H1H2H3 or 1 to 8)\n"
+           "  --size WxH            render size in pixels (default 512x512)\n"
+           "  --camera AZ,EL,DIST   camera angles in degrees and distance in window widths (default 0,0,1)\n"
+           "  --output PATH         render the current options to PATH, options are kept for next renders\n"
+           "  --batch FILE          read more options from FILE\n"
+           "validation : compare the conversions to the reference ones, then exit\n"
+           "  --validate            batch conversions, on all the 8 bits colors and 16 bits ones, no window opened\n"
+           "  --validate-gpu        GPU shader, on all the 8 bits colors, in a hidden window\n"
+           "threads, for all modes :\n"
+           "  --threads N           number of threads of the parallel stages (default : number of cores)\n"
+           "  --pin-threads         run each thread on its own core (Linux)\n";
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief The RenderJob struct a render of the 3D view written to an image file,
+ * without user interaction (headless mode)
+ */
+struct RenderJob{
+    RenderJob();
+    string image;/*!< image whose colors are drawn, empty for the sparse color space*/
+    int space;/*!< color space index, see cs::createColorspace*/
+    int width;/*!< render width, in pixels*/
+    int height;/*!< render height, in pixels*/
+    float azimuth;/*!< camera angle around the vertical axis, in degrees*/
+    float elevation;/*!< camera angle above the horizontal plane, in degrees*/
+    float distance;/*!< camera distance to the colors, in window widths*/
+    string output;/*!< written image (png, jpg...)*/
+};
+
+/**
+ * @brief parseRenderJobs read render jobs from command line arguments
+ *
+ * Options are kept from one job to the next, and each --output adds a job with
+ * the current options, so one process renders many views :
+ *
+ *     --image photo.jpg --size 512x512 --space Lab --output lab.png --space hsi --output hsi.png
+ *
+ * A batch file gives more arguments, any number of them by line ('#' starts a
+ * comment line).
+ *
+ * @param args arguments, without the program name
+ * @param jobs parsed jobs are added
+ * @param error why parsing failed
+ * @return false on unknown option or invalid value, or if options are given
+ * without any --output
+ */
+bool parseRenderJobs(const vector<string>& args, vector<RenderJob>& jobs, string& error);
+
+/**
+ * @brief getRenderUsage
+ * @return description of the headless mode options
+ */
+string getRenderUsage();
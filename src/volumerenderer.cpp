@@ -0,0 +1,155 @@
+#include "volumerenderer.h"
+
+#define STRINGIFY(A) #A
+
+/**
+ * @brief DENSITY opacity of a length of 1 through cells of the highest density,
+ * as an extinction coefficient
+ */
+static const float DENSITY=90.f;
+
+static const char* vertexShader="#version 120\n" STRINGIFY(
+    varying vec3 position;
+    void main(){
+        position=gl_Vertex.xyz;
+        gl_Position=gl_ModelViewProjectionMatrix*gl_Vertex;
+    }
+);
+
+static const char* fragmentShader="#version 120\n" POINT_FILTER_GLSL STRINGIFY(
+    uniform sampler3D volume;
+    uniform vec3 cameraPosition;
+    uniform float stepLength;
+    uniform float density;
+    //exit point of the ray, on a back face
+    varying vec3 position;
+
+    void main(){
+        vec3 ray=position-cameraPosition;
+        float tExit=length(ray);
+        vec3 direction=ray/tExit;
+        //entry point, the camera itself if it is inside the cube
+        vec3 t0=-cameraPosition/direction;
+        vec3 t1=(vec3(1.)-cameraPosition)/direction;
+        vec3 tNear=min(t0,t1);
+        float tEnter=max(max(max(tNear.x,tNear.y),tNear.z),0.);
+
+        //front to back, premultiplied colors
+        vec4 sum=vec4(0.);
+        for(int i=0;i<1024;i++){
+            float t=tEnter+(float(i)+0.5)*stepLength;
+            if(t>tExit || sum.a>0.99){
+                break;
+            }
+            vec3 p=cameraPosition+t*direction;
+            vec4 cell=texture3D(volume,p);
+            if(cell.a>0. && accepted(p)){
+                float alpha=1.-exp(-density*cell.a*stepLength);
+                sum+=(1.-sum.a)*alpha*vec4(cell.rgb,1.);
+            }
+        }
+        gl_FragColor=sum;
+    }
+);
+
+VolumeRenderer::VolumeRenderer(){
+    ready=false;
+    texture=0;
+    resolution=0;
+}
+
+VolumeRenderer::~VolumeRenderer(){
+    if(ready){
+        glDeleteTextures(1,&texture);
+    }
+}
+
+void VolumeRenderer::setup(){
+    glGenTextures(1,&texture);
+    glBindTexture(GL_TEXTURE_3D,texture);
+    //cells are drawn as they are : nearest, no blending of empty and full cells
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D,GL_TEXTURE_WRAP_R,GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D,0);
+
+    //two triangles by face of the cube
+    cube.setMode(OF_PRIMITIVE_TRIANGLES);
+    for(int axis=0;axis<3;axis++){
+        for(int side=0;side<2;side++){
+            ofVec3f corners[4];
+            for(int c=0;c<4;c++){
+                corners[c][axis]=side;
+                corners[c][(axis+1)%3]= c==1 || c==2 ? 1 : 0;
+                corners[c][(axis+2)%3]= c>=2 ? 1 : 0;
+            }
+            //counter clockwise seen from outside : the normal points out
+            ofVec3f outside;
+            outside[axis]= side==1 ? 1 : -1;
+            bool flip=(corners[1]-corners[0]).getCrossed(corners[2]-corners[0]).dot(outside)<0;
+            int order[6]={0,1,2,0,2,3};
+            for(int v=0;v<6;v++){
+                int c=order[v];
+                if(flip && (c==1 || c==3)){
+                    c=4-c;
+                }
+                cube.addVertex(corners[c]);
+            }
+        }
+    }
+
+    shader.setupShaderFromSource(GL_VERTEX_SHADER,vertexShader);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER,fragmentShader);
+    shader.linkProgram();
+    ready=true;
+}
+
+void VolumeRenderer::upload(const cs::DensityGrid& grid){
+    if(!ready){
+        setup();
+    }
+    grid.toRGBA(rgba);
+    resolution=grid.getResolution();
+    glBindTexture(GL_TEXTURE_3D,texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    glTexImage3D(GL_TEXTURE_3D,0,GL_RGBA8,resolution,resolution,resolution,0,GL_RGBA,GL_UNSIGNED_BYTE,rgba.data());
+    glBindTexture(GL_TEXTURE_3D,0);
+}
+
+void VolumeRenderer::setFilter(const PointFilter& filter){
+    this->filter=filter;
+}
+
+void VolumeRenderer::clear(){
+    resolution=0;
+}
+
+void VolumeRenderer::draw(const ofVec3f& cameraPosition){
+    if(!ready || resolution==0){
+        return;
+    }
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT);
+    //back faces only : a fragment by ray, wherever the camera is
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+
+    shader.begin();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D,texture);
+    shader.setUniform1i("volume",0);
+    shader.setUniform3f("cameraPosition",cameraPosition.x,cameraPosition.y,cameraPosition.z);
+    //two samples by cell
+    shader.setUniform1f("stepLength",0.5f/resolution);
+    shader.setUniform1f("density",DENSITY);
+    filter.setUniforms(shader);
+    cube.draw();
+    glBindTexture(GL_TEXTURE_3D,0);
+    shader.end();
+
+    glPopAttrib();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ofMain.h"
+#include "colorspace/densitygrid.h"
+#include "pointfilter.h"
+
+/**
+ * @brief The VolumeRenderer class draw a DensityGrid by ray marching
+ *
+ * The grid is uploaded as a 3D rgba texture (mean color, log density). The
+ * back faces of the normalized color space cube are drawn, and the fragment
+ * shader marches the ray from the camera through the cube, blending cells front
+ * to back until the ray is opaque. The cost depends on the window and the grid
+ * resolution, not on the number of colors.
+ */
+class VolumeRenderer{
+public:
+    VolumeRenderer();
+    ~VolumeRenderer();
+    /**
+     * @brief upload upload the cells of a grid
+     * @param grid
+     */
+    void upload(const cs::DensityGrid& grid);
+    /**
+     * @brief draw draw the volume inside a camera (the model matrix places the
+     * normalized color space)
+     * @param cameraPosition camera position in the normalized color space
+     */
+    void draw(const ofVec3f& cameraPosition);
+    /**
+     * @brief setFilter hide the cells rejected by a filter, from the next draw
+     * @param filter
+     */
+    void setFilter(const PointFilter& filter);
+    /**
+     * @brief clear draw nothing until next upload
+     */
+    void clear();
+private:
+    /**
+     * @brief setup create texture, cube and shader, needs a GL context
+     */
+    void setup();
+    bool ready;/*!< true once texture and shader are created*/
+    GLuint texture;/*!< 3D texture of the cells*/
+    int resolution;/*!< number of cells along each axis of the uploaded grid, 0 if nothing is uploaded*/
+    vector<unsigned char> rgba;/*!< cells converted for upload*/
+    ofMesh cube;/*!< faces of [0;1]^3, counter clockwise seen from outside*/
+    ofShader shader;/*!< ray marching*/
+    PointFilter filter;/*!< hidden cells*/
+};